@@ -0,0 +1,44 @@
+#include "barrier.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <immintrin.h>
+#include <mutex>
+
+
+generation_barrier::generation_barrier(std::size_t count, std::chrono::nanoseconds spin_time) :
+	_count(count),
+	_spin_time(spin_time),
+	_arrived(0),
+	_generation(0)
+{}
+
+void generation_barrier::arrive_and_wait()
+{
+	std::size_t const generation = _generation.load(std::memory_order_acquire);
+
+	if (_arrived.fetch_add(1, std::memory_order_acq_rel) + 1 == _count) {
+		// No thread can arrive again until it sees the new generation, so the count can be reset first.
+		_arrived.store(0, std::memory_order_relaxed);
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_generation.store(generation + 1, std::memory_order_release);
+		}
+		_released.notify_all();
+		return;
+	}
+
+	auto const spin_end = std::chrono::steady_clock::now() + _spin_time;
+	unsigned spins = 0;
+	while (_generation.load(std::memory_order_acquire) == generation) {
+		if (++spins % _spins_per_clock_check == 0 && std::chrono::steady_clock::now() >= spin_end) {
+			std::unique_lock<std::mutex> lock(_mutex);
+			_released.wait(lock, [this, generation]() {
+				return _generation.load(std::memory_order_acquire) != generation;
+			});
+			break;
+		}
+		_mm_pause();
+	}
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+
+// Reusable barrier for a fixed number of threads. Waiting threads spin for up to spin_time, since the other threads
+// usually arrive soon, and then sleep so that a thread waiting for a long time doesn't hold a core.
+class generation_barrier {
+public:
+	static inline constexpr std::chrono::nanoseconds default_spin_time = std::chrono::microseconds(100);
+
+	generation_barrier(std::size_t count, std::chrono::nanoseconds spin_time = default_spin_time);
+
+	void arrive_and_wait();
+
+private:
+	// Number of spin iterations between checks of the spin time limit.
+	static inline constexpr unsigned _spins_per_clock_check = 64;
+
+	std::size_t const _count;
+	std::chrono::nanoseconds const _spin_time;
+	std::atomic_size_t _arrived;
+	// Incremented each time all threads have arrived, which releases the waiting threads.
+	std::atomic_size_t _generation;
+	std::mutex _mutex;
+	std::condition_variable _released;
+};
@@ -0,0 +1,713 @@
+#include "execution.hpp"
+#include "grid.hpp"
+#include "hashlife.hpp"
+#include "instrument.hpp"
+#include "pipeline.hpp"
+#include "render.hpp"
+#include "rule.hpp"
+#include "snapshot.hpp"
+#include "update.hpp"
+#include "utility.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+
+// Default sweep: from grids whose buffers fit in L1 cache to grids that only fit in DRAM.
+constexpr std::size_t default_sizes[] = {64, 256, 1024, 4096};
+// Each repetition is sized to about this many cell updates, within the limits below.
+constexpr std::size_t target_cell_updates = std::size_t{1} << 28;
+constexpr std::size_t min_generations = 10;
+constexpr std::size_t max_generations = 1000;
+// Node limits that --verify-hashlife checks hashlife_universe with by default. The small ones make it collect garbage
+// after most steps, which on typical grids drops its memoised results at the smallest and keeps them at the next.
+constexpr std::size_t default_verify_max_nodes[] = {std::size_t{1} << 10, std::size_t{1} << 12,
+	hashlife_universe::default_max_nodes};
+
+constexpr char const* usage =
+	"Usage: gol_bench [options]\n"
+	"  --sizes <list>        Grid sizes, each <n> or <rows>x<cols> (default 64,256,1024,4096)\n"
+	"  --threads <list>      Thread counts (default powers of 2 up to the hardware threads)\n"
+	"  --engines <list>      byte and/or packed (default byte,packed)\n"
+	"  --rules <list>        Rules in B/S notation (default B3/S23)\n"
+	"  --pass <n>            Generations per pass over the grid (default 1)\n"
+	"  --warmup <n>          Untimed generations before the repetitions (default 20)\n"
+	"  --reps <n>            Repetitions (default 5)\n"
+	"  --generations <n>     Generations per repetition (default sized to the grid)\n"
+	"  --render <mode>       none, or render each generation on a pipeline thread and discard the frames (null) or\n"
+	"                        dump them (ppm or raw) (default none)\n"
+	"  --frames <dir>        Directory for dumped frames (default frames)\n"
+	"  --stats <file>        Write per-thread phase timings and population statistics to a file as JSON lines, once\n"
+	"                        per --stats-interval and at the end of each run. The file is emptied at startup, and\n"
+	"                        every run appends to it (needs a GOL_INSTRUMENT build)\n"
+	"  --stats-interval <ms> (default 1000)\n"
+	"  --checkpoint <file>   Write a snapshot of the grid to a file from a background thread every\n"
+	"                        --checkpoint-interval generations, and at the end of each run\n"
+	"  --checkpoint-interval <n> (default 1000)\n"
+	"  --format <format>     text, json or csv (default text)\n"
+	"  --output <file>       Write results to a file instead of stdout\n"
+	"  --verify-hashlife <k> Instead of benchmarking, check that hashlife_universe matches the engines when stepping\n"
+	"                        by 2^0 up to 2^k generations, then by 2^k and 2^0 in turn, for each size, thread count,\n"
+	"                        rule, engine and node limit\n"
+	"  --hashlife-max-nodes <list> Node limits for --verify-hashlife (default 1024,4096,16777216)\n";
+
+
+struct bench_options {
+	std::vector<std::pair<std::size_t, std::size_t>> sizes;
+	std::vector<std::size_t> threads;
+	std::vector<std::string> engines;
+	std::vector<life_rule> rules;
+	std::size_t generations_per_pass = 1;
+	std::size_t warmup = 20;
+	std::size_t reps = 5;
+	// 0 to size each repetition to the grid.
+	std::size_t generations = 0;
+	std::string render = "none";
+	std::string frames = "frames";
+	std::string stats;
+	std::size_t stats_interval_ms = 1000;
+	std::string checkpoint;
+	std::size_t checkpoint_interval = 1000;
+	std::string format = "text";
+	std::string output;
+	std::optional<std::size_t> verify_hashlife;
+	std::vector<std::size_t> hashlife_max_nodes;
+};
+
+struct bench_result {
+	std::string engine;
+	std::string rule;
+	std::size_t rows;
+	std::size_t cols;
+	std::size_t threads;
+	std::size_t generations_per_pass;
+	std::size_t generations;
+	// Per-generation latency over all repetitions.
+	double median_ns;
+	double p99_ns;
+	double mean_ns;
+	double cells_per_second;
+	double wall_seconds;
+	// User and system time of the whole process, which includes time spent spinning.
+	double cpu_seconds;
+	// CPU time as a fraction of the wall time of all threads.
+	double cpu_utilisation;
+	// Frames presented by the render pipeline during the repetitions.
+	std::uint64_t frames;
+};
+
+
+// Presenter for --render, which dumps frames or discards them.
+class bench_presenter {
+public:
+	bench_presenter(bench_options const& options)
+	{
+		if (options.render == "ppm" || options.render == "raw") {
+			_dump.emplace(options.frames, options.render == "ppm" ? frame_format::ppm : frame_format::raw);
+		}
+	}
+
+	void present(std::uint32_t const* pixels, std::size_t rows, std::size_t cols, std::uint64_t generation)
+	{
+		if (_dump) {
+			_dump->present(pixels, rows, cols, generation);
+		}
+	}
+
+private:
+	std::optional<frame_dump_renderer> _dump;
+};
+
+
+// Total user and system CPU time used by all threads of the process so far.
+double process_cpu_seconds()
+{
+#ifdef _WIN32
+	FILETIME creation, exit, kernel, user;
+	GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user);
+	auto const to_seconds = [](FILETIME const& time) {
+		ULARGE_INTEGER ticks;
+		ticks.LowPart = time.dwLowDateTime;
+		ticks.HighPart = time.dwHighDateTime;
+		return static_cast<double>(ticks.QuadPart) * 100e-9;
+	};
+	return to_seconds(kernel) + to_seconds(user);
+#else
+	rusage usage{};
+	getrusage(RUSAGE_SELF, &usage);
+	auto const to_seconds = [](timeval const& time) {
+		return static_cast<double>(time.tv_sec) + static_cast<double>(time.tv_usec) * 1e-6;
+	};
+	return to_seconds(usage.ru_utime) + to_seconds(usage.ru_stime);
+#endif
+}
+
+// Nearest-rank percentile of sorted samples.
+double percentile(std::vector<double> const& sorted, double p)
+{
+	auto const rank = static_cast<std::size_t>(std::ceil(p / 100.0 * static_cast<double>(sorted.size())));
+	return sorted[std::min(std::max(rank, std::size_t{1}), sorted.size()) - 1];
+}
+
+template<class Grid, class Updater>
+bench_result run(std::string const& engine, life_rule rule, std::size_t rows, std::size_t cols,
+	std::size_t num_threads, bench_options const& options)
+{
+	Grid grid(rows, cols);
+	grid.rand_init();
+
+	Updater updater(grid, rule);
+	cpu_executor<Updater> executor(grid, updater, num_threads);
+	std::optional<bench_presenter> presenter;
+	std::optional<render_pipeline<Grid, bench_presenter>> pipeline;
+	if (options.render != "none") {
+		presenter.emplace(options);
+		pipeline.emplace(grid, *presenter);
+	}
+	std::optional<checkpoint_writer> checkpoints;
+	if (!options.checkpoint.empty()) {
+		checkpoints.emplace();
+	}
+	std::optional<stats_dumper> dumper;
+	if (!options.stats.empty()) {
+		std::ostringstream label;
+		label << engine << ' ' << rule_string(rule) << ' ' << rows << 'x' << cols << ' ' << num_threads << " threads";
+		dumper.emplace(executor.stats(), options.stats, std::chrono::milliseconds(options.stats_interval_ms),
+			label.str());
+	}
+
+	std::size_t const cells = rows * cols;
+	std::size_t const pass = options.generations_per_pass;
+	std::size_t generations = options.generations;
+	if (generations == 0) {
+		generations = std::min(std::max(target_cell_updates / cells, min_generations), max_generations);
+	}
+	// Whole passes only, so that every sample covers the same number of generations.
+	generations = std::max((generations + pass - 1) / pass, std::size_t{1}) * pass;
+
+	std::uint64_t generation = 0;
+	auto const advance = [&]() {
+		if (pass == 1) {
+			executor.step();
+		}
+		else {
+			executor.update(pass);
+		}
+		if (pipeline) {
+			phase_timer timer(executor.stats(), phase::snapshot);
+			pipeline->end_snapshot();
+		}
+		{
+			phase_timer timer(executor.stats(), phase::load_next);
+			grid.load_next();
+		}
+		generation += pass;
+		// If the last checkpoint is still being written, this one is skipped rather than waited for.
+		std::size_t const interval = options.checkpoint_interval;
+		if (checkpoints && generation / interval != (generation - pass) / interval) {
+			phase_timer timer(executor.stats(), phase::snapshot);
+			checkpoints->write(options.checkpoint, grid, generation, rule_string(rule));
+		}
+		if (pipeline) {
+			pipeline->begin_snapshot(generation);
+		}
+	};
+
+	for (std::size_t n = 0; n < options.warmup; n += pass) {
+		advance();
+	}
+
+	std::vector<double> samples;
+	samples.reserve(options.reps * generations / pass);
+	std::uint64_t const frames_start = pipeline ? pipeline->frames_presented() : 0;
+	double const cpu_start = process_cpu_seconds();
+	auto const wall_start = std::chrono::steady_clock::now();
+	for (std::size_t rep = 0; rep < options.reps; ++rep) {
+		for (std::size_t n = 0; n < generations; n += pass) {
+			auto const t1 = std::chrono::steady_clock::now();
+			advance();
+			auto const t2 = std::chrono::steady_clock::now();
+			samples.push_back(std::chrono::duration<double, std::nano>(t2 - t1).count() / pass);
+		}
+	}
+	auto const wall_end = std::chrono::steady_clock::now();
+	double const cpu_end = process_cpu_seconds();
+	if (pipeline) {
+		pipeline->end_snapshot();
+		pipeline->flush();
+	}
+	if (checkpoints) {
+		checkpoints->wait();
+		checkpoints->write(options.checkpoint, grid, generation, rule_string(rule));
+		checkpoints->wait();
+	}
+
+	std::sort(samples.begin(), samples.end());
+	bench_result result;
+	result.engine = engine;
+	result.rule = rule_string(rule);
+	result.rows = rows;
+	result.cols = cols;
+	result.threads = num_threads;
+	result.generations_per_pass = pass;
+	result.generations = generations * options.reps;
+	result.median_ns = percentile(samples, 50.0);
+	result.p99_ns = percentile(samples, 99.0);
+	double total_ns = 0.0;
+	for (double const sample : samples) {
+		total_ns += sample;
+	}
+	result.mean_ns = total_ns / static_cast<double>(samples.size());
+	result.wall_seconds = std::chrono::duration<double>(wall_end - wall_start).count();
+	result.cells_per_second = static_cast<double>(cells) * static_cast<double>(result.generations)
+		/ result.wall_seconds;
+	result.cpu_seconds = cpu_end - cpu_start;
+	result.cpu_utilisation = result.cpu_seconds / (result.wall_seconds * static_cast<double>(num_threads));
+	result.frames = pipeline ? pipeline->frames_presented() - frames_start : 0;
+	return result;
+}
+
+bench_result run(std::string const& engine, life_rule rule, std::size_t rows, std::size_t cols,
+	std::size_t num_threads, bench_options const& options)
+{
+	bench_result result;
+	dispatch_dims(rows, cols, [&](auto rows_c, auto cols_c) {
+		dispatch_rule(rule, [&](auto birth_c, auto survival_c) {
+			constexpr std::size_t Rows = decltype(rows_c)::value;
+			constexpr std::size_t Cols = decltype(cols_c)::value;
+			constexpr std::uint16_t Birth = decltype(birth_c)::value;
+			constexpr std::uint16_t Survival = decltype(survival_c)::value;
+			if (engine == "packed") {
+				result = run<packed_grid<Rows, Cols>, packed_state_updater<Rows, Cols, Birth, Survival>>(engine, rule,
+					rows, cols, num_threads, options);
+			}
+			else {
+				result = run<game_grid<Rows, Cols>, state_updater<Rows, Cols, Birth, Survival>>(engine, rule, rows,
+					cols, num_threads, options);
+			}
+		});
+	});
+	return result;
+}
+
+
+// Steps for --verify-hashlife, as powers of 2. The step size grows, then alternates between the largest and smallest,
+// so that hashlife_universe discards memoised results of the wrong step size both ways.
+std::vector<std::size_t> verify_hashlife_steps(std::size_t max_log2)
+{
+	std::vector<std::size_t> steps;
+	for (std::size_t log2 = 0; log2 <= max_log2; ++log2) {
+		steps.push_back(log2);
+	}
+	steps.insert(steps.end(), {max_log2, 0, max_log2, 0});
+	return steps;
+}
+
+// Patterns spread by at most one cell per generation, so with a margin of dead cells wider than the total number of
+// generations, the wrapped grid matches the unbounded plane.
+std::size_t verify_hashlife_margin(std::size_t max_log2)
+{
+	std::size_t generations = 0;
+	for (std::size_t const log2 : verify_hashlife_steps(max_log2)) {
+		generations += std::size_t{1} << log2;
+	}
+	return generations + 1;
+}
+
+// Steps a random pattern by each of verify_hashlife_steps() in turn with both hashlife_universe and the executor, and
+// returns false if the grids differ after any step.
+template<class Grid, class Updater>
+bool verify_hashlife(life_rule rule, std::size_t rows, std::size_t cols, std::size_t num_threads,
+	std::size_t max_log2, std::size_t max_nodes)
+{
+	std::size_t const margin = verify_hashlife_margin(max_log2);
+	Grid grid(rows, cols);
+	std::mt19937_64 random(rows * cols);
+	std::bernoulli_distribution live(0.3);
+	for (std::size_t row = margin; row < rows - margin; ++row) {
+		for (std::size_t col = margin; col < cols - margin; ++col) {
+			grid.set_curr(row * cols + col, live(random));
+		}
+	}
+
+	Updater updater(grid, rule);
+	cpu_executor<Updater> executor(grid, updater, num_threads);
+	hashlife_universe universe(max_nodes, rule);
+	universe.load_curr(grid);
+
+	for (std::size_t const log2 : verify_hashlife_steps(max_log2)) {
+		executor.update(std::size_t{1} << log2);
+		grid.load_next();
+		universe.step(log2);
+
+		Grid expected(rows, cols);
+		universe.store_curr(expected);
+		std::uint64_t population = 0;
+		for (std::size_t idx = 0; idx < grid.size(); ++idx) {
+			if (grid.get_curr(idx) != expected.get_curr(idx)) {
+				return false;
+			}
+			population += grid.get_curr(idx);
+		}
+		// Catches cells the universe has outside the grid, which store_curr() leaves out.
+		if (population != universe.population()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool verify_hashlife(std::string const& engine, life_rule rule, std::size_t rows, std::size_t cols,
+	std::size_t num_threads, std::size_t max_log2, std::size_t max_nodes)
+{
+	bool result = false;
+	dispatch_dims(rows, cols, [&](auto rows_c, auto cols_c) {
+		dispatch_rule(rule, [&](auto birth_c, auto survival_c) {
+			constexpr std::size_t Rows = decltype(rows_c)::value;
+			constexpr std::size_t Cols = decltype(cols_c)::value;
+			constexpr std::uint16_t Birth = decltype(birth_c)::value;
+			constexpr std::uint16_t Survival = decltype(survival_c)::value;
+			if (engine == "packed") {
+				result = verify_hashlife<packed_grid<Rows, Cols>, packed_state_updater<Rows, Cols, Birth, Survival>>(
+					rule, rows, cols, num_threads, max_log2, max_nodes);
+			}
+			else {
+				result = verify_hashlife<game_grid<Rows, Cols>, state_updater<Rows, Cols, Birth, Survival>>(rule,
+					rows, cols, num_threads, max_log2, max_nodes);
+			}
+		});
+	});
+	return result;
+}
+
+
+void write_text(std::ostream& out, std::vector<bench_result> const& results)
+{
+	out << std::left << std::setw(8) << "engine" << std::setw(16) << "rule" << std::right << std::setw(12) << "size"
+		<< std::setw(8) << "threads" << std::setw(6) << "pass" << std::setw(8) << "gens"
+		<< std::setw(14) << "median (us)" << std::setw(12) << "p99 (us)" << std::setw(14) << "cells/s"
+		<< std::setw(12) << "CPU (s)" << std::setw(8) << "util" << std::setw(8) << "frames" << '\n';
+	for (auto const& r : results) {
+		std::ostringstream size;
+		size << r.rows << 'x' << r.cols;
+		out << std::left << std::setw(8) << r.engine << std::setw(16) << r.rule << std::right << std::setw(12)
+			<< size.str() << std::setw(8) << r.threads << std::setw(6) << r.generations_per_pass
+			<< std::setw(8) << r.generations
+			<< std::fixed << std::setprecision(2) << std::setw(14) << r.median_ns / 1000.0
+			<< std::setw(12) << r.p99_ns / 1000.0
+			<< std::scientific << std::setw(14) << r.cells_per_second
+			<< std::fixed << std::setprecision(3) << std::setw(12) << r.cpu_seconds
+			<< std::setprecision(2) << std::setw(8) << r.cpu_utilisation << std::setw(8) << r.frames << '\n';
+		out << std::defaultfloat;
+	}
+}
+
+void write_json(std::ostream& out, std::vector<bench_result> const& results)
+{
+	out << std::setprecision(9) << "[\n";
+	for (std::size_t i = 0; i < results.size(); ++i) {
+		auto const& r = results[i];
+		out << "  {\"engine\": \"" << r.engine << "\", \"rule\": \"" << r.rule << "\", \"rows\": " << r.rows
+			<< ", \"cols\": " << r.cols << ", \"threads\": " << r.threads
+			<< ", \"generations_per_pass\": " << r.generations_per_pass
+			<< ", \"generations\": " << r.generations << ", \"median_ns\": " << r.median_ns
+			<< ", \"p99_ns\": " << r.p99_ns << ", \"mean_ns\": " << r.mean_ns
+			<< ", \"cells_per_second\": " << r.cells_per_second << ", \"wall_seconds\": " << r.wall_seconds
+			<< ", \"cpu_seconds\": " << r.cpu_seconds << ", \"cpu_utilisation\": " << r.cpu_utilisation
+			<< ", \"frames\": " << r.frames << "}"
+			<< (i + 1 < results.size() ? ",\n" : "\n");
+	}
+	out << "]\n";
+}
+
+void write_csv(std::ostream& out, std::vector<bench_result> const& results)
+{
+	out << std::setprecision(9) << "engine,rule,rows,cols,threads,generations_per_pass,generations,median_ns,p99_ns,"
+		"mean_ns,cells_per_second,wall_seconds,cpu_seconds,cpu_utilisation,frames\n";
+	for (auto const& r : results) {
+		out << r.engine << ',' << r.rule << ',' << r.rows << ',' << r.cols << ',' << r.threads << ','
+			<< r.generations_per_pass << ',' << r.generations << ',' << r.median_ns << ',' << r.p99_ns << ','
+			<< r.mean_ns << ',' << r.cells_per_second << ',' << r.wall_seconds << ',' << r.cpu_seconds << ','
+			<< r.cpu_utilisation << ',' << r.frames << '\n';
+	}
+}
+
+
+std::vector<std::string> split_list(std::string const& list)
+{
+	std::vector<std::string> items;
+	std::istringstream stream(list);
+	std::string item;
+	while (std::getline(stream, item, ',')) {
+		if (!item.empty()) {
+			items.push_back(item);
+		}
+	}
+	return items;
+}
+
+std::size_t parse_count(std::string const& str)
+{
+	std::size_t pos = 0;
+	unsigned long long const val = std::stoull(str, &pos);
+	if (pos != str.size()) {
+		throw std::invalid_argument("Invalid number: " + str);
+	}
+	return static_cast<std::size_t>(val);
+}
+
+bench_options parse_options(int argc, char* argv[])
+{
+	bench_options options;
+	for (int i = 1; i < argc; ++i) {
+		std::string const option = argv[i];
+		if (i + 1 >= argc) {
+			throw std::invalid_argument("Missing value for " + option);
+		}
+		std::string const value = argv[++i];
+
+		if (option == "--sizes") {
+			for (auto const& size : split_list(value)) {
+				auto const x = size.find('x');
+				if (x == std::string::npos) {
+					options.sizes.emplace_back(parse_count(size), parse_count(size));
+				}
+				else {
+					options.sizes.emplace_back(parse_count(size.substr(0, x)), parse_count(size.substr(x + 1)));
+				}
+			}
+		}
+		else if (option == "--threads") {
+			for (auto const& threads : split_list(value)) {
+				options.threads.push_back(parse_count(threads));
+			}
+		}
+		else if (option == "--engines") {
+			options.engines = split_list(value);
+		}
+		else if (option == "--rules") {
+			for (auto const& rule : split_list(value)) {
+				options.rules.push_back(parse_rule(rule));
+			}
+		}
+		else if (option == "--pass") {
+			options.generations_per_pass = parse_count(value);
+		}
+		else if (option == "--warmup") {
+			options.warmup = parse_count(value);
+		}
+		else if (option == "--reps") {
+			options.reps = parse_count(value);
+		}
+		else if (option == "--generations") {
+			options.generations = parse_count(value);
+		}
+		else if (option == "--render") {
+			options.render = value;
+		}
+		else if (option == "--frames") {
+			options.frames = value;
+		}
+		else if (option == "--stats") {
+			options.stats = value;
+		}
+		else if (option == "--stats-interval") {
+			options.stats_interval_ms = parse_count(value);
+		}
+		else if (option == "--checkpoint") {
+			options.checkpoint = value;
+		}
+		else if (option == "--checkpoint-interval") {
+			options.checkpoint_interval = parse_count(value);
+		}
+		else if (option == "--format") {
+			options.format = value;
+		}
+		else if (option == "--output") {
+			options.output = value;
+		}
+		else if (option == "--verify-hashlife") {
+			options.verify_hashlife = parse_count(value);
+		}
+		else if (option == "--hashlife-max-nodes") {
+			for (auto const& max_nodes : split_list(value)) {
+				options.hashlife_max_nodes.push_back(parse_count(max_nodes));
+			}
+		}
+		else {
+			throw std::invalid_argument("Unknown option: " + option);
+		}
+	}
+
+	if (options.sizes.empty()) {
+		for (std::size_t const size : default_sizes) {
+			options.sizes.emplace_back(size, size);
+		}
+	}
+	if (options.threads.empty()) {
+		std::size_t const max_threads = default_num_threads();
+		for (std::size_t threads = 1; threads < max_threads; threads *= 2) {
+			options.threads.push_back(threads);
+		}
+		options.threads.push_back(max_threads);
+	}
+	if (options.engines.empty()) {
+		options.engines = {"byte", "packed"};
+	}
+	if (options.rules.empty()) {
+		options.rules = {conway_life};
+	}
+	if (options.hashlife_max_nodes.empty()) {
+		options.hashlife_max_nodes.assign(std::begin(default_verify_max_nodes), std::end(default_verify_max_nodes));
+	}
+
+	for (auto const& size : options.sizes) {
+		if (size.first < 2 || size.second < 2) {
+			throw std::invalid_argument("Grid dimensions must be at least 2.");
+		}
+	}
+	for (auto const& engine : options.engines) {
+		if (engine != "byte" && engine != "packed") {
+			throw std::invalid_argument("Unknown engine: " + engine);
+		}
+	}
+	if (std::find(options.threads.begin(), options.threads.end(), 0) != options.threads.end()) {
+		throw std::invalid_argument("Number of threads must be at least 1.");
+	}
+	if (options.generations_per_pass == 0 || options.reps == 0 || options.checkpoint_interval == 0) {
+		throw std::invalid_argument("Generations per pass, repetitions and checkpoint interval must be at least 1.");
+	}
+	if (options.render != "none" && options.render != "null" && options.render != "ppm" && options.render != "raw") {
+		throw std::invalid_argument("Unknown render mode: " + options.render);
+	}
+	if (!options.stats.empty() && !instrumentation_enabled) {
+		throw std::invalid_argument("--stats needs a build with GOL_INSTRUMENT defined.");
+	}
+	if (options.format != "text" && options.format != "json" && options.format != "csv") {
+		throw std::invalid_argument("Unknown format: " + options.format);
+	}
+	if (options.verify_hashlife) {
+		if (*options.verify_hashlife > hashlife_universe::max_step_log2) {
+			throw std::invalid_argument("--verify-hashlife step is too large.");
+		}
+		std::size_t const margin = verify_hashlife_margin(*options.verify_hashlife);
+		for (auto const& size : options.sizes) {
+			if (size.first <= 2 * margin || size.second <= 2 * margin) {
+				throw std::invalid_argument("Grid dimensions must be more than " + std::to_string(2 * margin)
+					+ " for --verify-hashlife " + std::to_string(*options.verify_hashlife) + ".");
+			}
+		}
+		for (auto const& rule : options.rules) {
+			if (rule.birth & 1) {
+				throw std::invalid_argument("hashlife_universe doesn't support B0 rules.");
+			}
+		}
+	}
+	return options;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc == 2 && std::string(argv[1]) == "--help") {
+		std::cout << usage;
+		return 0;
+	}
+
+	bench_options options;
+	try {
+		options = parse_options(argc, argv);
+	}
+	catch (std::exception const& e) {
+		std::cerr << e.what() << '\n' << usage;
+		return 1;
+	}
+
+	if (options.verify_hashlife) {
+		bool all_match = true;
+		for (auto const& size : options.sizes) {
+			for (std::size_t const threads : options.threads) {
+				for (auto const& rule : options.rules) {
+					for (auto const& engine : options.engines) {
+						for (std::size_t const max_nodes : options.hashlife_max_nodes) {
+							bool const match = verify_hashlife(engine, rule, size.first, size.second, threads,
+								*options.verify_hashlife, max_nodes);
+							all_match = all_match && match;
+							std::cerr << engine << ' ' << rule_string(rule) << ' ' << size.first << 'x' << size.second
+								<< ' ' << threads << " threads, " << max_nodes << " nodes: "
+								<< (match ? "match" : "MISMATCH") << std::endl;
+						}
+					}
+				}
+			}
+		}
+		return all_match ? 0 : 1;
+	}
+
+	if (!options.stats.empty()) {
+		// The file is emptied once here, and each run's stats_dumper then appends to it.
+		std::ofstream stats(options.stats, std::ios::trunc);
+		if (!stats) {
+			std::cerr << "Failed to open " << options.stats << std::endl;
+			return 1;
+		}
+	}
+
+	std::vector<bench_result> results;
+	try {
+		for (auto const& size : options.sizes) {
+			for (std::size_t const threads : options.threads) {
+				for (auto const& rule : options.rules) {
+					for (auto const& engine : options.engines) {
+						results.push_back(run(engine, rule, size.first, size.second, threads, options));
+						// Progress goes to stderr, so that stdout only has the results.
+						std::cerr << engine << ' ' << rule_string(rule) << ' ' << size.first << 'x' << size.second
+							<< ' ' << threads << " threads: " << results.back().cells_per_second << " cells/s"
+							<< std::endl;
+					}
+				}
+			}
+		}
+	}
+	catch (std::exception const& e) {
+		// Such as failing to write frames or checkpoints.
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	std::ofstream file;
+	if (!options.output.empty()) {
+		file.open(options.output);
+		if (!file) {
+			std::cerr << "Failed to open " << options.output << std::endl;
+			return 1;
+		}
+	}
+	std::ostream& out = options.output.empty() ? std::cout : file;
+	if (options.format == "json") {
+		write_json(out, results);
+	}
+	else if (options.format == "csv") {
+		write_csv(out, results);
+	}
+	else {
+		write_text(out, results);
+	}
+}
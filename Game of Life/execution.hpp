@@ -1,56 +1,89 @@
 #pragma once
 
+#include "barrier.hpp"
 #include "grid.hpp"
+#include "instrument.hpp"
+#include "schedule.hpp"
 #include "update.hpp"
 #include "utility.hpp"
 
-#include <array>
 #include <atomic>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
 #include <thread>
-#include <utility>
+#include <vector>
 
 
-template<std::size_t Rows, std::size_t Cols, class Renderer, std::size_t NumThreads>
+// Updater is state_updater or packed_state_updater, which determines the grid type.
+// The grid is split into tiles of whole rows, sized so that a tile's input and output fit in L2 cache. Tiles are
+// distributed between threads with a tile_scheduler.
+// step() skips tiles where neither the tile nor its neighbours changed in the last generation. Such a tile can't
+// change, and both grid buffers already hold its state, so it doesn't need updating.
+// Frames are rendered from a copy of the grid by a render_pipeline (see pipeline.hpp), between calls.
+template<class Updater>
 class cpu_executor {
 public:
-	~cpu_executor();
-	cpu_executor(game_grid<Rows, Cols>& grid, state_updater<Rows, Cols>& updater, Renderer& renderer);
+	using grid_type = typename Updater::grid_type;
 
-	void render_and_update();
+	~cpu_executor();
+	// Worker threads waiting for the next generation spin for up to spin_time before sleeping.
+	cpu_executor(grid_type& grid, Updater& updater, std::size_t num_threads = default_num_threads(),
+		std::chrono::nanoseconds spin_time = generation_barrier::default_spin_time);
 
-private:
-	game_grid<Rows, Cols>* _grid;
-	state_updater<Rows, Cols>* _updater;
-	Renderer* _renderer;
-	std::array<std::thread, NumThreads - 1> _threads;
-	static inline constexpr std::array<std::pair<std::size_t, std::size_t>, NumThreads> _partitions = partition<NumThreads>(Rows * Cols);
-	std::atomic_size_t _sync1;
-	std::atomic_size_t _sync2;
-	bool _exit;
-
-	template<std::size_t Idx>
-	void _start_threads(std::array<std::thread, NumThreads - 1>& threads);
-	template<std::size_t ThreadIdx>
-	void _render_and_update();
-	template<std::size_t ThreadIdx>
-	void _thread_func();
-};
+	std::size_t num_threads() const;
+	std::size_t num_tiles() const;
+	// Number of tiles updated by the last call to step().
+	std::size_t active_tiles() const;
 
-template<std::size_t Rows, std::size_t Cols, class Renderer>
-class cpu_executor<Rows, Cols, Renderer, 0> {};
+	// Advances the grid by one generation. The result is in the grid's next buffer.
+	void step();
+	// Advances the grid by several generations in one pass over the grid. Each tile is updated together with a halo of
+	// surrounding cells, so the whole grid only needs to be synchronised once. Like step(), the result is in the grid's
+	// next buffer.
+	void update(std::size_t generations);
+	// Marks every tile as changed. Must be called after the grid is modified other than by the executor.
+	void reset_activity();
+	// Per-thread phase timings and the population of each pass, if built with GOL_INSTRUMENT (see instrument.hpp).
+	executor_stats& stats();
 
-template<std::size_t Rows, std::size_t Cols, class Renderer>
-class cpu_executor<Rows, Cols, Renderer, 1> {
-public:
-	cpu_executor(game_grid<Rows, Cols>& grid, state_updater<Rows, Cols>& updater, Renderer& renderer);
+private:
+	// Cache budget for the rows read and written by one tile. About half a typical L2, to leave room for the rest.
+	static inline constexpr std::size_t _tile_cache_size = 256 * 1024;
+	// Smaller tiles are used if needed to give each thread at least this many, so that work can be balanced.
+	static inline constexpr std::size_t _min_tiles_per_thread = 4;
+	// When updating multiple generations, tiles are made at least this many times the number of generations in rows,
+	// to limit the work repeated in overlapping halos.
+	static inline constexpr std::size_t _min_tile_rows_per_generation = 16;
 
-	void render_and_update();
+	grid_type* _grid;
+	Updater* _updater;
+	std::size_t _tile_rows;
+	std::size_t _num_tiles;
+	// Whether each tile changed in the last generation, and the tiles to process in the current pass.
+	std::vector<std::uint8_t> _tile_changed;
+	std::vector<std::size_t> _active_tiles;
+	// Number of tiles either side of a tile that its cells' neighbours can be in.
+	std::size_t _tile_radius;
+	tile_scheduler _scheduler;
+	// Work for the current pass, set before the workers are started.
+	std::size_t _pass_tile_rows;
+	std::size_t _pass_generations;
+	bool _pass_tracks_changes;
+	// Workers wait on _start between generations and on _finish once all tiles are done.
+	generation_barrier _start;
+	generation_barrier _finish;
+	std::atomic_bool _exit;
+	executor_stats _stats;
+	// Index 0 is the main thread, which has no std::thread.
+	std::vector<std::thread> _threads;
 
-private:
-	game_grid<Rows, Cols>* _grid;
-	state_updater<Rows, Cols>* _updater;
-	Renderer* _renderer;
+	void _find_active_tiles();
+	void _run_pass(std::size_t tile_rows, std::size_t generations, bool track_changes);
+	void _process_tiles(std::size_t thread_idx);
+	// Waits at _finish for the other threads.
+	void _finish_pass(std::size_t thread_idx);
+	void _thread_func(std::size_t thread_idx);
 };
 
 
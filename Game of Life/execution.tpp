@@ -1,107 +1,229 @@
 #pragma once
 
 #include "grid.hpp"
+#include "instrument.hpp"
 #include "update.hpp"
 
-#include <array>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <stdexcept>
 #include <thread>
 
 
-template<std::size_t Rows, std::size_t Cols, class Renderer, std::size_t NumThreads>
-cpu_executor<Rows, Cols, Renderer, NumThreads>::~cpu_executor()
+template<class Updater>
+cpu_executor<Updater>::~cpu_executor()
 {
-	_sync1 = 0;
-	while (_sync2 != _threads.size()) {}
 	_exit = true;
-	_sync2 = 0;
-	
-	for (auto& t : _threads) {
-		t.join();
+	_start.arrive_and_wait();
+
+	for (std::size_t i = 1; i < _threads.size(); ++i) {
+		_threads[i].join();
 	}
 }
 
-template<std::size_t Rows, std::size_t Cols, class Renderer, std::size_t NumThreads>
-cpu_executor<Rows, Cols, Renderer, NumThreads>::cpu_executor(game_grid<Rows, Cols>& grid,
-		state_updater<Rows, Cols>& updater, Renderer& renderer) :
+template<class Updater>
+cpu_executor<Updater>::cpu_executor(grid_type& grid, Updater& updater, std::size_t num_threads,
+		std::chrono::nanoseconds spin_time) :
 	_grid(&grid),
 	_updater(&updater),
-	_renderer(&renderer),
-	_sync1(0),
-	_sync2(0),
-	_exit(false)
+	_tile_rows(0),
+	_num_tiles(0),
+	_tile_radius(0),
+	_scheduler(std::max(num_threads, std::size_t{1})),
+	_pass_tile_rows(0),
+	_pass_generations(0),
+	_pass_tracks_changes(false),
+	_start(std::max(num_threads, std::size_t{1}), spin_time),
+	_finish(std::max(num_threads, std::size_t{1}), spin_time),
+	_exit(false),
+	_stats(std::max(num_threads, std::size_t{1}))
 {
-	_start_threads<0>(_threads);
-	while (_sync1 != _threads.size()) {}
+	if (num_threads == 0) {
+		throw std::invalid_argument("Number of threads must be at least 1.");
+	}
+
+	std::size_t const rows = grid.rows();
+	std::size_t const max_tile_rows = std::max(_tile_cache_size / (2 * grid.row_bytes()), std::size_t{1});
+	std::size_t const balanced_tile_rows = std::max(rows / (num_threads * _min_tiles_per_thread), std::size_t{1});
+	_tile_rows = std::min(max_tile_rows, balanced_tile_rows);
+	_num_tiles = (rows + _tile_rows - 1) / _tile_rows;
+	_tile_changed.assign(_num_tiles, true);
+	_active_tiles.reserve(_num_tiles);
+	// The last cell of a row neighbours the first cell of the row after next, which is two tiles away if a tile has
+	// only one row.
+	std::size_t const last_tile_rows = rows - (_num_tiles - 1) * _tile_rows;
+	_tile_radius = std::min(_tile_rows, last_tile_rows) >= 2 ? 1 : 2;
+
+	_threads.resize(num_threads);
+	for (std::size_t i = 1; i < num_threads; ++i) {
+		_threads[i] = std::thread(&cpu_executor::_thread_func, this, i);
+	}
 }
 
-template<std::size_t Rows, std::size_t Cols, class Renderer, std::size_t NumThreads>
-void cpu_executor<Rows, Cols, Renderer, NumThreads>::render_and_update()
+template<class Updater>
+std::size_t cpu_executor<Updater>::num_threads() const
 {
-	_sync1 = 0;
-	while (_sync2 != _threads.size()) {}
-	_sync2 = 0;
-
-	_render_and_update<0>();
+	return _threads.size();
+}
 
-	while (_sync1 != _threads.size()) {}
+template<class Updater>
+std::size_t cpu_executor<Updater>::num_tiles() const
+{
+	return _num_tiles;
 }
 
-template<std::size_t Rows, std::size_t Cols, class Renderer, std::size_t NumThreads>
-template<std::size_t ThreadIdx>
-void cpu_executor<Rows, Cols, Renderer, NumThreads>::_render_and_update()
+template<class Updater>
+std::size_t cpu_executor<Updater>::active_tiles() const
 {
-	constexpr auto& partition = std::get<ThreadIdx>(_partitions);
-	constexpr auto begin = partition.first;
-	constexpr auto end = partition.first + partition.second;
+	return _active_tiles.size();
+}
 
-	_renderer->render(begin, end);
-	_updater->precomp(begin, end);
-	_updater->update(begin, end);
+template<class Updater>
+void cpu_executor<Updater>::step()
+{
+	_find_active_tiles();
+	_run_pass(_tile_rows, 1, true);
 }
 
-template<std::size_t Rows, std::size_t Cols, class Renderer, std::size_t NumThreads>
-template<std::size_t Idx>
-void cpu_executor<Rows, Cols, Renderer, NumThreads>::_start_threads(std::array<std::thread, NumThreads - 1>& threads)
+template<class Updater>
+void cpu_executor<Updater>::update(std::size_t generations)
 {
-	if constexpr (Idx < NumThreads - 1) {
-		std::get<Idx>(threads) = std::thread(&cpu_executor::_thread_func<Idx + 1>, this);
-		_start_threads<Idx + 1>(threads);
+	std::size_t const tile_rows = std::min(std::max(_tile_rows, _min_tile_rows_per_generation * generations),
+		_grid->rows());
+	std::size_t const num_tiles = (_grid->rows() + tile_rows - 1) / tile_rows;
+	_active_tiles.resize(num_tiles);
+	for (std::size_t tile = 0; tile < num_tiles; ++tile) {
+		_active_tiles[tile] = tile;
 	}
+	_run_pass(tile_rows, generations, false);
+	// The last generation of the pass isn't compared against the one before, so the next pass updates every tile.
+	reset_activity();
 }
 
-template<std::size_t Rows, std::size_t Cols, class Renderer, std::size_t NumThreads>
-template<std::size_t ThreadIdx>
-void cpu_executor<Rows, Cols, Renderer, NumThreads>::_thread_func()
+template<class Updater>
+void cpu_executor<Updater>::reset_activity()
 {
-	static_assert(ThreadIdx >= 1);
+	std::fill(_tile_changed.begin(), _tile_changed.end(), true);
+}
 
-	while (true) {
-		++_sync1;
-		while (_sync1 != 0) {}
-		++_sync2;
-		while (_sync2 != 0) {}
+template<class Updater>
+executor_stats& cpu_executor<Updater>::stats()
+{
+	return _stats;
+}
 
-		if (_exit) {
-			break;
+template<class Updater>
+void cpu_executor<Updater>::_find_active_tiles()
+{
+	_active_tiles.clear();
+	for (std::size_t tile = 0; tile < _num_tiles; ++tile) {
+		auto const offset = static_cast<std::ptrdiff_t>(tile);
+		auto const radius = static_cast<std::ptrdiff_t>(_tile_radius);
+		for (std::ptrdiff_t i = offset - radius; i <= offset + radius; ++i) {
+			if (_tile_changed[wrap(i, _num_tiles)]) {
+				_active_tiles.push_back(tile);
+				break;
+			}
 		}
+	}
+	// Inactive tiles stay unchanged for the next generation.
+	for (std::size_t const tile : _active_tiles) {
+		_tile_changed[tile] = false;
+	}
+}
 
-		_render_and_update<ThreadIdx>();
+template<class Updater>
+void cpu_executor<Updater>::_run_pass(std::size_t tile_rows, std::size_t generations, bool track_changes)
+{
+	// Only single generation passes track which tiles changed.
+	debug_assert(!track_changes || (tile_rows == _tile_rows && generations == 1));
+
+	_pass_tile_rows = tile_rows;
+	_pass_generations = generations;
+	_pass_tracks_changes = track_changes;
+	_scheduler.reset(_active_tiles.size());
+	if constexpr (instrumentation_enabled) {
+		_stats.begin_pass((_grid->rows() + tile_rows - 1) / tile_rows);
+	}
+
+	if (_threads.size() == 1) {
+		_process_tiles(0);
+	}
+	else {
+		_start.arrive_and_wait();
+		_process_tiles(0);
+		_finish_pass(0);
+	}
+	if constexpr (instrumentation_enabled) {
+		_stats.end_thread_pass(0);
+		_stats.end_pass(generations, _active_tiles.size());
 	}
 }
 
+template<class Updater>
+void cpu_executor<Updater>::_process_tiles(std::size_t thread_idx)
+{
+	std::size_t const rows = _grid->rows();
+	std::size_t const cols = _grid->cols();
 
-template<std::size_t Rows, std::size_t Cols, class Renderer>
-cpu_executor<Rows, Cols, Renderer, 1>::cpu_executor(game_grid<Rows, Cols>& grid,
-		state_updater<Rows, Cols>& updater, Renderer& renderer) :
-	_grid(&grid),
-	_updater(&updater),
-	_renderer(&renderer)
-{}
+	if constexpr (instrumentation_enabled) {
+		_stats.begin_thread_pass(thread_idx);
+	}
+
+	std::size_t active_idx;
+	while (_scheduler.next_tile(thread_idx, active_idx)) {
+		std::size_t const tile = _active_tiles[active_idx];
+		std::size_t const begin = tile * _pass_tile_rows * cols;
+		std::size_t const end = std::min((tile + 1) * _pass_tile_rows, rows) * cols;
+
+		if constexpr (instrumentation_enabled) {
+			// The updater counts the cells as it writes them.
+			lap_timer timer(_stats, thread_idx);
+			cell_census census = {0, 0, 0};
+			if (_pass_tracks_changes) {
+				_tile_changed[tile] = _updater->update(begin, end, census);
+			}
+			else {
+				_updater->update(begin, end, _pass_generations, census);
+			}
+			timer.lap(phase::update);
+			_stats.add_census(thread_idx, tile, census);
+		}
+		else if (_pass_tracks_changes) {
+			_tile_changed[tile] = _updater->update(begin, end);
+		}
+		else {
+			_updater->update(begin, end, _pass_generations);
+		}
+	}
+}
 
-template<std::size_t Rows, std::size_t Cols, class Renderer>
-void cpu_executor<Rows, Cols, Renderer, 1>::render_and_update()
+template<class Updater>
+void cpu_executor<Updater>::_finish_pass(std::size_t thread_idx)
 {
-	_renderer->render(0, Rows * Cols);
-	_updater->precomp(0, Rows * Cols);
-	_updater->update(0, Rows * Cols);
+	lap_timer timer(_stats, thread_idx);
+	_finish.arrive_and_wait();
+	if constexpr (instrumentation_enabled) {
+		timer.lap(phase::barrier);
+	}
+}
+
+template<class Updater>
+void cpu_executor<Updater>::_thread_func(std::size_t thread_idx)
+{
+	debug_assert(thread_idx >= 1);
+
+	while (true) {
+		_start.arrive_and_wait();
+		if (_exit) {
+			break;
+		}
+
+		_process_tiles(thread_idx);
+		_finish_pass(thread_idx);
+		if constexpr (instrumentation_enabled) {
+			_stats.end_thread_pass(thread_idx);
+		}
+	}
 }
@@ -0,0 +1,14 @@
+#include "grid.hpp"
+
+#include <cstddef>
+#include <stdexcept>
+
+
+grid_dims<dynamic_extent, dynamic_extent>::grid_dims(std::size_t rows, std::size_t cols) :
+	_rows(rows),
+	_cols(cols)
+{
+	if (rows < 2 || cols < 2) {
+		throw std::invalid_argument("Grid must have at least 2 rows and 2 columns.");
+	}
+}
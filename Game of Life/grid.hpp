@@ -4,18 +4,57 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <limits>
+#include <tuple>
 
 
+// Used for both Rows and Cols to make the grid dimensions runtime values instead of template parameters.
+inline constexpr std::size_t dynamic_extent = std::numeric_limits<std::size_t>::max();
+
 template<std::size_t Rows, std::size_t Cols>
-class game_grid {
+class grid_dims {
 public:
 	static_assert(Rows >= 2 && Cols >= 2);
 
-	static inline constexpr std::size_t rows = Rows;
-	static inline constexpr std::size_t cols = Cols;
-	static inline constexpr std::size_t size = Rows * Cols;
+	grid_dims() = default;
+	grid_dims(std::size_t rows, std::size_t cols);
+
+	static constexpr std::size_t rows() { return Rows; }
+	static constexpr std::size_t cols() { return Cols; }
+	static constexpr std::size_t size() { return Rows * Cols; }
+};
+
+template<>
+class grid_dims<dynamic_extent, dynamic_extent> {
+public:
+	grid_dims(std::size_t rows, std::size_t cols);
+
+	std::size_t rows() const { return _rows; }
+	std::size_t cols() const { return _cols; }
+	std::size_t size() const { return _rows * _cols; }
+
+private:
+	std::size_t _rows;
+	std::size_t _cols;
+};
 
+// Dimensions which get a compile-time specialisation from dispatch_dims(). All other dimensions use dynamic_extent.
+using common_grid_dims = std::tuple<grid_dims<512, 512>, grid_dims<800, 800>, grid_dims<1024, 1024>,
+	grid_dims<2000, 2000>>;
+
+// Calls func(std::integral_constant<std::size_t, Rows>{}, std::integral_constant<std::size_t, Cols>{}) with the
+// matching common_grid_dims entry, or with dynamic_extent if there is none.
+template<std::size_t DimsIdx = 0, class Func>
+void dispatch_dims(std::size_t rows, std::size_t cols, Func&& func);
+
+
+template<std::size_t Rows, std::size_t Cols>
+class game_grid : public grid_dims<Rows, Cols> {
+public:
 	game_grid();
+	game_grid(std::size_t rows, std::size_t cols);
+
+	std::size_t row_bytes() const;
 
 	std::uint8_t* curr();
 	std::uint8_t const* curr() const;
@@ -23,6 +62,7 @@ public:
 	std::uint8_t const* next() const;
 
 	bool get_curr(std::size_t idx) const;
+	void set_curr(std::size_t idx, bool state);
 	void set_next(std::size_t idx, bool state);
 
 	void load_next();
@@ -33,5 +73,45 @@ private:
 	aligned_array<std::uint8_t, 32> _next;
 };
 
+// Stores one cell per bit. Each row starts on a new word, and the unused bits at the end of a row are always 0.
+template<std::size_t Rows, std::size_t Cols>
+class packed_grid : public grid_dims<Rows, Cols> {
+public:
+	using word_type = std::uint64_t;
+
+	static inline constexpr std::size_t word_bits = 64;
+
+	packed_grid();
+	packed_grid(std::size_t rows, std::size_t cols);
+
+	std::size_t row_words() const;
+	std::size_t words() const;
+	std::size_t row_bytes() const;
+
+	word_type* curr();
+	word_type const* curr() const;
+	word_type* next();
+	word_type const* next() const;
+
+	bool get_curr(std::size_t idx) const;
+	void set_curr(std::size_t idx, bool state);
+	void set_next(std::size_t idx, bool state);
+
+	void load_next();
+	void rand_init();
+
+private:
+	aligned_array<word_type, 32> _curr;
+	aligned_array<word_type, 32> _next;
+
+	std::size_t _word_idx(std::size_t idx) const;
+	word_type _bit(std::size_t idx) const;
+};
+
+
+// Copies the current state of one grid into another of the same dimensions.
+template<class SrcGrid, class DstGrid>
+void copy_curr(SrcGrid const& src, DstGrid& dst);
+
 
 #include "grid.tpp"
@@ -3,13 +3,64 @@
 #include <algorithm>
 #include <chrono>
 #include <random>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+
+
+template<std::size_t Rows, std::size_t Cols>
+grid_dims<Rows, Cols>::grid_dims(std::size_t rows, std::size_t cols)
+{
+	if (rows != Rows || cols != Cols) {
+		throw std::invalid_argument("Grid dimensions don't match the template arguments.");
+	}
+}
+
+
+template<std::size_t DimsIdx, class Func>
+void dispatch_dims(std::size_t rows, std::size_t cols, Func&& func)
+{
+	if constexpr (DimsIdx < std::tuple_size_v<common_grid_dims>) {
+		using dims = std::tuple_element_t<DimsIdx, common_grid_dims>;
+		if (rows == dims::rows() && cols == dims::cols()) {
+			func(std::integral_constant<std::size_t, dims::rows()>{},
+				std::integral_constant<std::size_t, dims::cols()>{});
+		}
+		else {
+			dispatch_dims<DimsIdx + 1>(rows, cols, std::forward<Func>(func));
+		}
+	}
+	else {
+		func(std::integral_constant<std::size_t, dynamic_extent>{},
+			std::integral_constant<std::size_t, dynamic_extent>{});
+	}
+}
 
 
 template<std::size_t Rows, std::size_t Cols>
 game_grid<Rows, Cols>::game_grid() :
-	_curr(size),
-	_next(size)
-{}
+	_curr(this->size()),
+	_next(this->size())
+{
+	std::fill_n(_curr.data(), this->size(), std::uint8_t{0});
+	std::fill_n(_next.data(), this->size(), std::uint8_t{0});
+}
+
+template<std::size_t Rows, std::size_t Cols>
+game_grid<Rows, Cols>::game_grid(std::size_t rows, std::size_t cols) :
+	grid_dims<Rows, Cols>(rows, cols),
+	_curr(this->size()),
+	_next(this->size())
+{
+	std::fill_n(_curr.data(), this->size(), std::uint8_t{0});
+	std::fill_n(_next.data(), this->size(), std::uint8_t{0});
+}
+
+template<std::size_t Rows, std::size_t Cols>
+std::size_t game_grid<Rows, Cols>::row_bytes() const
+{
+	return this->cols();
+}
 
 template<std::size_t Rows, std::size_t Cols>
 std::uint8_t* game_grid<Rows, Cols>::curr()
@@ -41,6 +92,12 @@ bool game_grid<Rows, Cols>::get_curr(std::size_t idx) const
 	return _curr[idx];
 }
 
+template<std::size_t Rows, std::size_t Cols>
+void game_grid<Rows, Cols>::set_curr(std::size_t idx, bool state)
+{
+	_curr[idx] = state;
+}
+
 template<std::size_t Rows, std::size_t Cols>
 void game_grid<Rows, Cols>::set_next(std::size_t idx, bool state)
 {
@@ -57,5 +114,133 @@ template<std::size_t Rows, std::size_t Cols>
 void game_grid<Rows, Cols>::rand_init()
 {
 	static std::default_random_engine rand_eng(std::chrono::system_clock::now().time_since_epoch().count());
-	std::generate_n(_curr.data(), size, []() { return rand_eng() & 1u; });
+	std::generate_n(_curr.data(), this->size(), []() { return rand_eng() & 1u; });
+}
+
+
+template<std::size_t Rows, std::size_t Cols>
+packed_grid<Rows, Cols>::packed_grid() :
+	_curr(words()),
+	_next(words())
+{
+	std::fill_n(_curr.data(), words(), word_type{0});
+	std::fill_n(_next.data(), words(), word_type{0});
+}
+
+template<std::size_t Rows, std::size_t Cols>
+packed_grid<Rows, Cols>::packed_grid(std::size_t rows, std::size_t cols) :
+	grid_dims<Rows, Cols>(rows, cols),
+	_curr(words()),
+	_next(words())
+{
+	std::fill_n(_curr.data(), words(), word_type{0});
+	std::fill_n(_next.data(), words(), word_type{0});
+}
+
+template<std::size_t Rows, std::size_t Cols>
+std::size_t packed_grid<Rows, Cols>::row_words() const
+{
+	return (this->cols() + word_bits - 1) / word_bits;
+}
+
+template<std::size_t Rows, std::size_t Cols>
+std::size_t packed_grid<Rows, Cols>::words() const
+{
+	return this->rows() * row_words();
+}
+
+template<std::size_t Rows, std::size_t Cols>
+std::size_t packed_grid<Rows, Cols>::row_bytes() const
+{
+	return row_words() * sizeof(word_type);
+}
+
+template<std::size_t Rows, std::size_t Cols>
+typename packed_grid<Rows, Cols>::word_type* packed_grid<Rows, Cols>::curr()
+{
+	return _curr.data();
+}
+
+template<std::size_t Rows, std::size_t Cols>
+typename packed_grid<Rows, Cols>::word_type const* packed_grid<Rows, Cols>::curr() const
+{
+	return _curr.data();
+}
+
+template<std::size_t Rows, std::size_t Cols>
+typename packed_grid<Rows, Cols>::word_type* packed_grid<Rows, Cols>::next()
+{
+	return _next.data();
+}
+
+template<std::size_t Rows, std::size_t Cols>
+typename packed_grid<Rows, Cols>::word_type const* packed_grid<Rows, Cols>::next() const
+{
+	return _next.data();
+}
+
+template<std::size_t Rows, std::size_t Cols>
+bool packed_grid<Rows, Cols>::get_curr(std::size_t idx) const
+{
+	return _curr[_word_idx(idx)] & _bit(idx);
+}
+
+template<std::size_t Rows, std::size_t Cols>
+void packed_grid<Rows, Cols>::set_curr(std::size_t idx, bool state)
+{
+	auto& word = _curr[_word_idx(idx)];
+	word = state ? (word | _bit(idx)) : (word & ~_bit(idx));
+}
+
+template<std::size_t Rows, std::size_t Cols>
+void packed_grid<Rows, Cols>::set_next(std::size_t idx, bool state)
+{
+	auto& word = _next[_word_idx(idx)];
+	word = state ? (word | _bit(idx)) : (word & ~_bit(idx));
+}
+
+template<std::size_t Rows, std::size_t Cols>
+void packed_grid<Rows, Cols>::load_next()
+{
+	swap(_curr, _next);
+}
+
+template<std::size_t Rows, std::size_t Cols>
+void packed_grid<Rows, Cols>::rand_init()
+{
+	static std::mt19937_64 rand_eng(std::chrono::system_clock::now().time_since_epoch().count());
+	std::size_t const tail_bits = this->cols() % word_bits;
+	word_type const last_word_mask = tail_bits == 0 ? ~word_type{0} : (word_type{1} << tail_bits) - 1;
+
+	for (std::size_t row = 0; row < this->rows(); ++row) {
+		auto const row_data = _curr.data() + row * row_words();
+		std::generate_n(row_data, row_words(), []() { return static_cast<word_type>(rand_eng()); });
+		row_data[row_words() - 1] &= last_word_mask;
+	}
+}
+
+template<std::size_t Rows, std::size_t Cols>
+std::size_t packed_grid<Rows, Cols>::_word_idx(std::size_t idx) const
+{
+	debug_assert(idx < this->size());
+	return (idx / this->cols()) * row_words() + (idx % this->cols()) / word_bits;
+}
+
+template<std::size_t Rows, std::size_t Cols>
+typename packed_grid<Rows, Cols>::word_type packed_grid<Rows, Cols>::_bit(std::size_t idx) const
+{
+	return word_type{1} << ((idx % this->cols()) % word_bits);
+}
+
+
+template<class SrcGrid, class DstGrid>
+void copy_curr(SrcGrid const& src, DstGrid& dst)
+{
+	if (src.rows() != dst.rows() || src.cols() != dst.cols()) {
+		throw std::invalid_argument("Grid dimensions differ.");
+	}
+
+	for (std::size_t idx = 0; idx < src.size(); ++idx) {
+		dst.set_curr(idx, src.get_curr(idx));
+	}
 }
@@ -0,0 +1,403 @@
+#include "hashlife.hpp"
+#include "utility.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+
+hashlife_universe::hashlife_universe(std::size_t max_nodes, life_rule rule) :
+	_max_nodes(max_nodes),
+	_rule(rule),
+	_nodes{
+		{_no_node, _no_node, _no_node, _no_node, _no_node, 0, 0},
+		{_no_node, _no_node, _no_node, _no_node, _no_node, 0, 1}
+	},
+	_table_count(0),
+	_root(_no_node),
+	_generation(0),
+	_step_log2(0)
+{
+	if (rule.birth & 1u) {
+		throw std::invalid_argument("HashLife doesn't support rules with B0.");
+	}
+	_rehash();
+	_root = _empty_node(3);
+}
+
+bool hashlife_universe::get(std::int64_t row, std::int64_t col) const
+{
+	node_index idx = _root;
+	std::int64_t half_size = _half_size(_nodes[idx].level);
+	if (row < -half_size || row >= half_size || col < -half_size || col >= half_size) {
+		return false;
+	}
+
+	// Descends with row and col relative to the top left of the node.
+	row += half_size;
+	col += half_size;
+	while (_nodes[idx].level > 0 && _nodes[idx].population > 0) {
+		node const& n = _nodes[idx];
+		half_size = _half_size(n.level);
+		bool const south = row >= half_size;
+		bool const east = col >= half_size;
+		idx = south ? (east ? n.se : n.sw) : (east ? n.ne : n.nw);
+		row -= south ? half_size : 0;
+		col -= east ? half_size : 0;
+	}
+	return idx == _live_leaf;
+}
+
+void hashlife_universe::set(std::int64_t row, std::int64_t col, bool state)
+{
+	auto const contains = [this, row, col]() {
+		std::int64_t const half_size = _half_size(_nodes[_root].level);
+		return row >= -half_size && row < half_size && col >= -half_size && col < half_size;
+	};
+	while (!contains()) {
+		_expand();
+	}
+
+	std::int64_t const half_size = _half_size(_nodes[_root].level);
+	_root = _set(_root, row + half_size, col + half_size, state);
+}
+
+void hashlife_universe::step(std::size_t log2_generations)
+{
+	if (log2_generations > max_step_log2) {
+		throw std::invalid_argument("Step is too large.");
+	}
+
+	_set_step(log2_generations);
+	// The pattern moves at most 1 cell per generation, so once it is in the middle half of a root of level at least
+	// log2_generations + 2, a root twice the size has room for it to grow into the centre, which is the result.
+	while (_nodes[_root].level < log2_generations + 2 || !_root_is_padded()) {
+		_expand();
+	}
+	_expand();
+	_root = _result(_root);
+	_generation += std::uint64_t{1} << log2_generations;
+
+	if (_nodes.size() > _max_nodes) {
+		collect_garbage();
+	}
+}
+
+std::uint64_t hashlife_universe::generation() const
+{
+	return _generation;
+}
+
+std::uint64_t hashlife_universe::population() const
+{
+	return _nodes[_root].population;
+}
+
+std::size_t hashlife_universe::num_nodes() const
+{
+	return _nodes.size();
+}
+
+life_rule hashlife_universe::rule() const
+{
+	return _rule;
+}
+
+void hashlife_universe::collect_garbage()
+{
+	std::vector<std::uint8_t> live(_nodes.size(), false);
+	_mark(live, true);
+	if (static_cast<std::size_t>(std::count(live.begin(), live.end(), true)) > _max_nodes / 2) {
+		std::fill(live.begin(), live.end(), false);
+		_mark(live, false);
+	}
+
+	// Nodes are moved down in order, so the leaves stay where they are.
+	std::vector<node_index> new_idx(_nodes.size(), _no_node);
+	std::size_t count = 0;
+	for (std::size_t idx = 0; idx < _nodes.size(); ++idx) {
+		if (live[idx]) {
+			new_idx[idx] = static_cast<node_index>(count);
+			_nodes[count++] = _nodes[idx];
+		}
+	}
+	_nodes.resize(count);
+
+	for (std::size_t idx = 2; idx < _nodes.size(); ++idx) {
+		node& n = _nodes[idx];
+		n.nw = new_idx[n.nw];
+		n.ne = new_idx[n.ne];
+		n.sw = new_idx[n.sw];
+		n.se = new_idx[n.se];
+		n.result = n.result == _no_node ? _no_node : new_idx[n.result];
+	}
+	_root = new_idx[_root];
+	_empty.clear();
+	_rehash();
+}
+
+hashlife_universe::node_index hashlife_universe::_join(node_index nw, node_index ne, node_index sw, node_index se)
+{
+	std::size_t const mask = _table.size() - 1;
+	std::size_t slot = _hash(nw, ne, sw, se) & mask;
+	for (; _table[slot] != _no_node; slot = (slot + 1) & mask) {
+		node const& n = _nodes[_table[slot]];
+		if (n.nw == nw && n.ne == ne && n.sw == sw && n.se == se) {
+			return _table[slot];
+		}
+	}
+
+	if (_nodes.size() >= _no_node) {
+		throw std::length_error("Too many HashLife nodes.");
+	}
+	auto const add_saturated = [](std::uint64_t a, std::uint64_t b) {
+		return a > std::numeric_limits<std::uint64_t>::max() - b ? std::numeric_limits<std::uint64_t>::max() : a + b;
+	};
+	std::uint64_t const population = add_saturated(
+		add_saturated(_nodes[nw].population, _nodes[ne].population),
+		add_saturated(_nodes[sw].population, _nodes[se].population));
+
+	auto const idx = static_cast<node_index>(_nodes.size());
+	_nodes.push_back({nw, ne, sw, se, _no_node, _nodes[nw].level + 1, population});
+	_table[slot] = idx;
+	++_table_count;
+	if (_table_count * 2 > _table.size()) {
+		_rehash();
+	}
+	return idx;
+}
+
+hashlife_universe::node_index hashlife_universe::_empty_node(std::size_t level)
+{
+	if (_empty.empty()) {
+		_empty.push_back(_dead_leaf);
+	}
+	while (_empty.size() <= level) {
+		node_index const smaller = _empty.back();
+		_empty.push_back(_join(smaller, smaller, smaller, smaller));
+	}
+	return _empty[level];
+}
+
+hashlife_universe::node_index hashlife_universe::_centre(node_index idx)
+{
+	node const n = _nodes[idx];
+	return _join(_nodes[n.nw].se, _nodes[n.ne].sw, _nodes[n.sw].ne, _nodes[n.se].nw);
+}
+
+hashlife_universe::node_index hashlife_universe::_centre_horizontal(node_index west, node_index east)
+{
+	node const w = _nodes[west];
+	node const e = _nodes[east];
+	return _join(w.ne, e.nw, w.se, e.sw);
+}
+
+hashlife_universe::node_index hashlife_universe::_centre_vertical(node_index north, node_index south)
+{
+	node const n = _nodes[north];
+	node const s = _nodes[south];
+	return _join(n.sw, n.se, s.nw, s.ne);
+}
+
+hashlife_universe::node_index hashlife_universe::_result(node_index idx)
+{
+	// _nodes can be reallocated by _join(), so nodes are copied rather than referenced.
+	node const n = _nodes[idx];
+	if (n.result != _no_node) {
+		return n.result;
+	}
+	debug_assert(n.level >= 2);
+
+	node_index result;
+	if (n.level == 2) {
+		result = _base_result(idx);
+	}
+	else {
+		// The node is split into 3x3 overlapping subnodes of level n - 1, whose centres are combined into 4 nodes
+		// of level n - 1 again, whose centres make up the result. For the full step of 2^(n - 2) generations each
+		// stage advances half of it, otherwise only the second stage advances.
+		node_index sub[3][3] = {
+			{n.nw, _centre_horizontal(n.nw, n.ne), n.ne},
+			{_centre_vertical(n.nw, n.sw), _centre(idx), _centre_vertical(n.ne, n.se)},
+			{n.sw, _centre_horizontal(n.sw, n.se), n.se}
+		};
+		bool const full_step = n.level - 2 <= _step_log2;
+		for (auto& sub_row : sub) {
+			for (auto& s : sub_row) {
+				s = full_step ? _result(s) : _centre(s);
+			}
+		}
+
+		node_index const nw = _result(_join(sub[0][0], sub[0][1], sub[1][0], sub[1][1]));
+		node_index const ne = _result(_join(sub[0][1], sub[0][2], sub[1][1], sub[1][2]));
+		node_index const sw = _result(_join(sub[1][0], sub[1][1], sub[2][0], sub[2][1]));
+		node_index const se = _result(_join(sub[1][1], sub[1][2], sub[2][1], sub[2][2]));
+		result = _join(nw, ne, sw, se);
+	}
+
+	_nodes[idx].result = result;
+	return result;
+}
+
+hashlife_universe::node_index hashlife_universe::_base_result(node_index idx)
+{
+	// Level 2 nodes are 4x4 cells, and the result is the middle 2x2 after 1 generation. Leaf indices are the cell
+	// states.
+	node const n = _nodes[idx];
+	node_index const quadrants[2][2] = {{n.nw, n.ne}, {n.sw, n.se}};
+	std::uint8_t cells[4][4];
+	for (std::size_t row = 0; row < 4; ++row) {
+		for (std::size_t col = 0; col < 4; ++col) {
+			node const& quadrant = _nodes[quadrants[row / 2][col / 2]];
+			node_index const leaves[2][2] = {{quadrant.nw, quadrant.ne}, {quadrant.sw, quadrant.se}};
+			cells[row][col] = static_cast<std::uint8_t>(leaves[row % 2][col % 2]);
+		}
+	}
+
+	node_index next[2][2];
+	for (std::size_t row = 1; row <= 2; ++row) {
+		for (std::size_t col = 1; col <= 2; ++col) {
+			std::uint8_t neighbours = 0;
+			for (std::size_t i = row - 1; i <= row + 1; ++i) {
+				for (std::size_t j = col - 1; j <= col + 1; ++j) {
+					neighbours += cells[i][j];
+				}
+			}
+			neighbours -= cells[row][col];
+			bool const state = (((cells[row][col] ? _rule.survival : _rule.birth) >> neighbours) & 1u) != 0;
+			next[row - 1][col - 1] = state ? _live_leaf : _dead_leaf;
+		}
+	}
+	return _join(next[0][0], next[0][1], next[1][0], next[1][1]);
+}
+
+void hashlife_universe::_expand()
+{
+	node const root = _nodes[_root];
+	node_index const empty = _empty_node(root.level - 1);
+	node_index const nw = _join(empty, empty, empty, root.nw);
+	node_index const ne = _join(empty, empty, root.ne, empty);
+	node_index const sw = _join(empty, root.sw, empty, empty);
+	node_index const se = _join(root.se, empty, empty, empty);
+	_root = _join(nw, ne, sw, se);
+}
+
+bool hashlife_universe::_root_is_padded() const
+{
+	node const& root = _nodes[_root];
+	if (root.level < 2) {
+		return false;
+	}
+
+	auto const empty = [this](node_index idx) { return _nodes[idx].population == 0; };
+	node const& nw = _nodes[root.nw];
+	node const& ne = _nodes[root.ne];
+	node const& sw = _nodes[root.sw];
+	node const& se = _nodes[root.se];
+	return empty(nw.nw) && empty(nw.ne) && empty(nw.sw)
+		&& empty(ne.nw) && empty(ne.ne) && empty(ne.se)
+		&& empty(sw.nw) && empty(sw.sw) && empty(sw.se)
+		&& empty(se.ne) && empty(se.sw) && empty(se.se);
+}
+
+void hashlife_universe::_set_step(std::size_t log2_generations)
+{
+	if (log2_generations == _step_log2) {
+		return;
+	}
+
+	// Nodes up to this level advance the same number of generations with either step.
+	std::size_t const unaffected_level = std::min(log2_generations, _step_log2) + 2;
+	for (node& n : _nodes) {
+		if (n.level > unaffected_level) {
+			n.result = _no_node;
+		}
+	}
+	_step_log2 = log2_generations;
+}
+
+hashlife_universe::node_index hashlife_universe::_set(node_index idx, std::int64_t row, std::int64_t col, bool state)
+{
+	node const n = _nodes[idx];
+	if (n.level == 0) {
+		return state ? _live_leaf : _dead_leaf;
+	}
+
+	std::int64_t const half_size = _half_size(n.level);
+	if (row < half_size) {
+		if (col < half_size) {
+			return _join(_set(n.nw, row, col, state), n.ne, n.sw, n.se);
+		}
+		else {
+			return _join(n.nw, _set(n.ne, row, col - half_size, state), n.sw, n.se);
+		}
+	}
+	else {
+		if (col < half_size) {
+			return _join(n.nw, n.ne, _set(n.sw, row - half_size, col, state), n.se);
+		}
+		else {
+			return _join(n.nw, n.ne, n.sw, _set(n.se, row - half_size, col - half_size, state));
+		}
+	}
+}
+
+void hashlife_universe::_rehash()
+{
+	std::size_t table_size = 1024;
+	while (table_size < 4 * _nodes.size()) {
+		table_size *= 2;
+	}
+	_table.assign(table_size, _no_node);
+	_table_count = 0;
+
+	std::size_t const mask = table_size - 1;
+	for (std::size_t idx = 2; idx < _nodes.size(); ++idx) {
+		node const& n = _nodes[idx];
+		std::size_t slot = _hash(n.nw, n.ne, n.sw, n.se) & mask;
+		while (_table[slot] != _no_node) {
+			slot = (slot + 1) & mask;
+		}
+		_table[slot] = static_cast<node_index>(idx);
+		++_table_count;
+	}
+}
+
+void hashlife_universe::_mark(std::vector<std::uint8_t>& live, bool keep_results) const
+{
+	live[_dead_leaf] = true;
+	live[_live_leaf] = true;
+
+	std::vector<node_index> pending{_root};
+	while (!pending.empty()) {
+		node_index const idx = pending.back();
+		pending.pop_back();
+		if (live[idx]) {
+			continue;
+		}
+		live[idx] = true;
+
+		node const& n = _nodes[idx];
+		pending.insert(pending.end(), {n.nw, n.ne, n.sw, n.se});
+		if (keep_results && n.result != _no_node) {
+			pending.push_back(n.result);
+		}
+	}
+}
+
+std::size_t hashlife_universe::_hash(node_index nw, node_index ne, node_index sw, node_index se)
+{
+	std::uint64_t hash = nw;
+	hash = hash * 0x9E3779B97F4A7C15u + ne;
+	hash = hash * 0x9E3779B97F4A7C15u + sw;
+	hash = hash * 0x9E3779B97F4A7C15u + se;
+	return static_cast<std::size_t>(hash ^ (hash >> 29));
+}
+
+std::int64_t hashlife_universe::_half_size(std::size_t level)
+{
+	return level == 0 ? 0 : std::int64_t{1} << (level - 1);
+}
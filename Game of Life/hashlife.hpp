@@ -0,0 +1,107 @@
+#pragma once
+
+#include "rule.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+// Runs a pattern with the HashLife algorithm, which can advance structured patterns by huge numbers of generations.
+// The universe is a quadtree whose nodes are hash-consed, so identical regions are stored once, and each node memoises
+// its centre some number of generations ahead.
+// Unlike the grids, the universe is an unbounded plane rather than a wrapped grid. It matches state_updater as long as
+// the pattern stays clear of the edges of the grid it is compared with.
+class hashlife_universe {
+public:
+	static inline constexpr std::size_t default_max_nodes = std::size_t{1} << 24;
+	// Keeps the generation count and cell coordinates well within 64 bits.
+	static inline constexpr std::size_t max_step_log2 = 48;
+
+	// Nodes are garbage collected between steps once there are more than max_nodes. A single step can temporarily
+	// exceed it. Throws std::invalid_argument for rules with B0, which would fill the unbounded plane.
+	hashlife_universe(std::size_t max_nodes = default_max_nodes, life_rule rule = conway_life);
+
+	// Replaces the universe with the current state of a grid. Cell (row, col) of the grid is at the same coordinates
+	// in the universe.
+	template<class Grid>
+	void load_curr(Grid const& grid);
+	// Writes the cells of the universe within the grid into the grid's current state.
+	template<class Grid>
+	void store_curr(Grid& grid) const;
+
+	bool get(std::int64_t row, std::int64_t col) const;
+	void set(std::int64_t row, std::int64_t col, bool state);
+
+	// Advances the universe by 2^log2_generations generations.
+	void step(std::size_t log2_generations);
+
+	std::uint64_t generation() const;
+	// Saturates at the maximum value of std::uint64_t.
+	std::uint64_t population() const;
+	std::size_t num_nodes() const;
+	life_rule rule() const;
+
+	// Frees nodes not used by the current universe. Memoised results are kept if there is room for them.
+	void collect_garbage();
+
+private:
+	using node_index = std::uint32_t;
+
+	static inline constexpr node_index _no_node = ~node_index{0};
+	// Leaves are single cells.
+	static inline constexpr node_index _dead_leaf = 0;
+	static inline constexpr node_index _live_leaf = 1;
+
+	// A node of level n is a square of 2^n cells made of four nodes of level n - 1.
+	struct node {
+		node_index nw;
+		node_index ne;
+		node_index sw;
+		node_index se;
+		// The centre of the node, of level n - 1, 2^min(n - 2, _step_log2) generations ahead.
+		node_index result;
+		std::uint32_t level;
+		std::uint64_t population;
+	};
+
+	std::size_t _max_nodes;
+	life_rule _rule;
+	std::vector<node> _nodes;
+	// Open addressing hash table of all nodes except leaves.
+	std::vector<node_index> _table;
+	std::size_t _table_count;
+	// Empty node of each level, created as needed.
+	std::vector<node_index> _empty;
+	// The root is centred on the origin, so it covers [-2^(level - 1), 2^(level - 1)) in both directions.
+	node_index _root;
+	std::uint64_t _generation;
+	std::size_t _step_log2;
+
+	node_index _join(node_index nw, node_index ne, node_index sw, node_index se);
+	node_index _empty_node(std::size_t level);
+	node_index _centre(node_index idx);
+	node_index _centre_horizontal(node_index west, node_index east);
+	node_index _centre_vertical(node_index north, node_index south);
+	node_index _result(node_index idx);
+	node_index _base_result(node_index idx);
+	// Puts a border of empty cells around the root, doubling its size.
+	void _expand();
+	// Whether all the live cells of the root are within the middle half of it in both directions.
+	bool _root_is_padded() const;
+	void _set_step(std::size_t log2_generations);
+
+	template<class Grid>
+	node_index _build(Grid const& grid, std::size_t level, std::int64_t row, std::int64_t col);
+	template<class Grid>
+	void _write(Grid& grid, node_index idx, std::int64_t row, std::int64_t col) const;
+	node_index _set(node_index idx, std::int64_t row, std::int64_t col, bool state);
+
+	void _rehash();
+	void _mark(std::vector<std::uint8_t>& live, bool keep_results) const;
+	static std::size_t _hash(node_index nw, node_index ne, node_index sw, node_index se);
+	static std::int64_t _half_size(std::size_t level);
+};
+
+
+#include "hashlife.tpp"
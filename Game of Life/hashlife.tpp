@@ -0,0 +1,71 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+
+template<class Grid>
+void hashlife_universe::load_curr(Grid const& grid)
+{
+	std::size_t level = 3;
+	while (_half_size(level) < static_cast<std::int64_t>(std::max(grid.rows(), grid.cols()))) {
+		++level;
+	}
+	_root = _build(grid, level, -_half_size(level), -_half_size(level));
+	_generation = 0;
+}
+
+template<class Grid>
+void hashlife_universe::store_curr(Grid& grid) const
+{
+	for (std::size_t idx = 0; idx < grid.size(); ++idx) {
+		grid.set_curr(idx, false);
+	}
+	std::int64_t const half_size = _half_size(_nodes[_root].level);
+	_write(grid, _root, -half_size, -half_size);
+}
+
+template<class Grid>
+hashlife_universe::node_index hashlife_universe::_build(Grid const& grid, std::size_t level, std::int64_t row,
+	std::int64_t col)
+{
+	auto const rows = static_cast<std::int64_t>(grid.rows());
+	auto const cols = static_cast<std::int64_t>(grid.cols());
+	std::int64_t const size = std::int64_t{1} << level;
+	if (row >= rows || col >= cols || row + size <= 0 || col + size <= 0) {
+		return _empty_node(level);
+	}
+	if (level == 0) {
+		return grid.get_curr(static_cast<std::size_t>(row * cols + col)) ? _live_leaf : _dead_leaf;
+	}
+
+	std::int64_t const half_size = size / 2;
+	node_index const nw = _build(grid, level - 1, row, col);
+	node_index const ne = _build(grid, level - 1, row, col + half_size);
+	node_index const sw = _build(grid, level - 1, row + half_size, col);
+	node_index const se = _build(grid, level - 1, row + half_size, col + half_size);
+	return _join(nw, ne, sw, se);
+}
+
+template<class Grid>
+void hashlife_universe::_write(Grid& grid, node_index idx, std::int64_t row, std::int64_t col) const
+{
+	node const& n = _nodes[idx];
+	auto const rows = static_cast<std::int64_t>(grid.rows());
+	auto const cols = static_cast<std::int64_t>(grid.cols());
+	std::int64_t const size = std::int64_t{1} << n.level;
+	if (n.population == 0 || row >= rows || col >= cols || row + size <= 0 || col + size <= 0) {
+		return;
+	}
+	if (n.level == 0) {
+		grid.set_curr(static_cast<std::size_t>(row * cols + col), true);
+		return;
+	}
+
+	std::int64_t const half_size = size / 2;
+	_write(grid, n.nw, row, col);
+	_write(grid, n.ne, row, col + half_size);
+	_write(grid, n.sw, row + half_size, col);
+	_write(grid, n.se, row + half_size, col + half_size);
+}
@@ -0,0 +1,261 @@
+#include "instrument.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+
+
+namespace {
+
+constexpr std::array<char const*, phase_count> phase_names = {
+	"update", "barrier", "load_next", "snapshot"
+};
+
+}
+
+
+char const* phase_name(phase p)
+{
+	return phase_names[static_cast<std::size_t>(p)];
+}
+
+void write_stats_json(std::ostream& out, stats_report const& report, std::string const& label)
+{
+	out << '{';
+	if (!label.empty()) {
+		out << "\"label\": \"" << label << "\", ";
+	}
+	out << "\"passes\": " << report.passes << ", \"generations\": " << report.generations
+		<< ", \"mean_imbalance\": " << report.mean_imbalance << ", \"max_imbalance\": " << report.max_imbalance
+		<< ", \"dropped_samples\": " << report.dropped_samples << ", \"threads\": [";
+	for (std::size_t thread_idx = 0; thread_idx < report.threads.size(); ++thread_idx) {
+		out << (thread_idx == 0 ? "{" : ", {");
+		for (std::size_t phase_idx = 0; phase_idx < phase_count; ++phase_idx) {
+			auto const& totals = report.threads[thread_idx][phase_idx];
+			out << (phase_idx == 0 ? "\"" : ", \"") << phase_names[phase_idx] << "\": {\"count\": " << totals.count
+				<< ", \"total_ns\": " << totals.total_ns << ", \"max_ns\": " << totals.max_ns << "}";
+		}
+		out << "}";
+	}
+	out << "], \"recent_passes\": [";
+	for (std::size_t i = 0; i < report.recent_passes.size(); ++i) {
+		auto const& pass = report.recent_passes[i];
+		out << (i == 0 ? "{" : ", {") << "\"generation\": " << pass.generation
+			<< ", \"generations\": " << pass.generations << ", \"active_tiles\": " << pass.active_tiles
+			<< ", \"population\": " << pass.census.population << ", \"births\": " << pass.census.births
+			<< ", \"deaths\": " << pass.census.deaths << ", \"max_busy_ns\": " << pass.max_busy_ns
+			<< ", \"mean_busy_ns\": " << pass.mean_busy_ns << "}";
+	}
+	out << "]}";
+}
+
+
+#ifdef GOL_INSTRUMENT
+
+executor_stats::executor_stats(std::size_t num_threads, std::size_t ring_capacity) :
+	_slots(num_threads),
+	_pass(0),
+	_generation(0),
+	_pass_ring(ring_capacity),
+	_report{0, 0, {}, 0.0, 0.0, 0, {}},
+	_imbalance_sum(0.0)
+{
+	for (std::size_t thread_idx = 0; thread_idx < num_threads; ++thread_idx) {
+		_rings.push_back(std::make_unique<spsc_ring<phase_sample>>(ring_capacity));
+	}
+	_report.threads.resize(num_threads, std::array<phase_totals, phase_count>{});
+}
+
+void executor_stats::begin_pass(std::size_t num_tiles)
+{
+	// The executor updates every tile whenever it changes the tiles, so stale counts are never summed.
+	if (_tile_population.size() != num_tiles) {
+		_tile_population.assign(num_tiles, 0);
+	}
+}
+
+void executor_stats::begin_thread_pass(std::size_t thread_idx)
+{
+	thread_slot& slot = _slots[thread_idx];
+	slot.pass = _pass;
+	slot.ns = {};
+	slot.births = 0;
+	slot.deaths = 0;
+}
+
+void executor_stats::add_time(std::size_t thread_idx, phase p, std::uint64_t ns)
+{
+	_slots[thread_idx].ns[static_cast<std::size_t>(p)] += ns;
+}
+
+void executor_stats::add_census(std::size_t thread_idx, std::size_t tile, cell_census const& census)
+{
+	_tile_population[tile] = census.population;
+	_slots[thread_idx].births += census.births;
+	_slots[thread_idx].deaths += census.deaths;
+}
+
+void executor_stats::end_thread_pass(std::size_t thread_idx)
+{
+	thread_slot const& slot = _slots[thread_idx];
+	for (std::size_t phase_idx = 0; phase_idx < phase_count; ++phase_idx) {
+		if (slot.ns[phase_idx] != 0) {
+			_rings[thread_idx]->push(phase_sample{slot.pass + 1, slot.ns[phase_idx], static_cast<phase>(phase_idx)});
+		}
+	}
+	_slots[thread_idx].published.store(slot.pass + 1, std::memory_order_release);
+}
+
+void executor_stats::end_pass(std::size_t generations, std::size_t active_tiles)
+{
+	// The other threads only write their barrier times until the next pass begins.
+	std::uint64_t max_busy_ns = 0;
+	std::uint64_t total_busy_ns = 0;
+	cell_census census = {0, 0, 0};
+	for (auto const& slot : _slots) {
+		std::uint64_t const busy_ns = slot.ns[static_cast<std::size_t>(phase::update)];
+		max_busy_ns = std::max(max_busy_ns, busy_ns);
+		total_busy_ns += busy_ns;
+		census.births += slot.births;
+		census.deaths += slot.deaths;
+	}
+	for (std::uint64_t const population : _tile_population) {
+		census.population += population;
+	}
+
+	_generation += generations;
+	_pass_ring.push(pass_sample{_generation, generations, active_tiles, census, max_busy_ns,
+		total_busy_ns / _slots.size()});
+	++_pass;
+}
+
+void executor_stats::record(phase p, std::uint64_t ns)
+{
+	_rings[0]->push(phase_sample{_pass, ns, p});
+}
+
+stats_report executor_stats::collect()
+{
+	std::lock_guard<std::mutex> lock(_collect_mutex);
+
+	_report.recent_passes.clear();
+	pass_sample pass;
+	while (_pass_ring.pop(pass)) {
+		double const imbalance = pass.max_busy_ns == 0 ? 0.0
+			: 1.0 - static_cast<double>(pass.mean_busy_ns) / static_cast<double>(pass.max_busy_ns);
+		++_report.passes;
+		_report.generations = pass.generation;
+		_imbalance_sum += imbalance;
+		_report.max_imbalance = std::max(_report.max_imbalance, imbalance);
+		_report.recent_passes.push_back(pass);
+	}
+	_report.mean_imbalance = _report.passes == 0 ? 0.0 : _imbalance_sum / static_cast<double>(_report.passes);
+
+	// Every thread has finished the passes ended so far, and is about to push their samples, if it hasn't yet. Threads
+	// may also have pushed samples of the next pass, which are left for the next report.
+	phase_sample sample;
+	for (std::size_t thread_idx = 0; thread_idx < _rings.size(); ++thread_idx) {
+		while (_slots[thread_idx].published.load(std::memory_order_acquire) < _report.passes) {
+			std::this_thread::yield();
+		}
+		while (_rings[thread_idx]->peek(sample) && sample.passes <= _report.passes) {
+			_rings[thread_idx]->pop(sample);
+			auto& totals = _report.threads[thread_idx][static_cast<std::size_t>(sample.kind)];
+			++totals.count;
+			totals.total_ns += sample.ns;
+			totals.max_ns = std::max(totals.max_ns, sample.ns);
+		}
+	}
+
+	_report.dropped_samples = _pass_ring.dropped();
+	for (auto const& ring : _rings) {
+		_report.dropped_samples += ring->dropped();
+	}
+	return _report;
+}
+
+
+lap_timer::lap_timer(executor_stats& stats, std::size_t thread_idx) :
+	_stats(&stats),
+	_thread_idx(thread_idx),
+	_last(std::chrono::steady_clock::now())
+{}
+
+void lap_timer::lap(phase p)
+{
+	auto const now = std::chrono::steady_clock::now();
+	_stats->add_time(_thread_idx, p,
+		static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - _last).count()));
+	_last = now;
+}
+
+
+phase_timer::~phase_timer()
+{
+	_stats->record(_phase, static_cast<std::uint64_t>(
+		std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _start).count()));
+}
+
+phase_timer::phase_timer(executor_stats& stats, phase p) :
+	_stats(&stats),
+	_phase(p),
+	_start(std::chrono::steady_clock::now())
+{}
+
+
+stats_dumper::~stats_dumper()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_exit = true;
+	}
+	_cond.notify_all();
+	_thread.join();
+}
+
+stats_dumper::stats_dumper(executor_stats& stats, std::filesystem::path const& path,
+	std::chrono::milliseconds interval, std::string label) :
+	_stats(&stats),
+	_interval(interval),
+	_path(path),
+	_label(std::move(label)),
+	_exit(false)
+{
+	std::ofstream out(_path, std::ios::app);
+	if (!out) {
+		throw std::runtime_error("Failed to open " + _path.string());
+	}
+	_thread = std::thread(&stats_dumper::_thread_func, this);
+}
+
+void stats_dumper::_thread_func()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (!_exit) {
+		_cond.wait_for(lock, _interval, [this]() { return _exit; });
+		lock.unlock();
+		_dump();
+		lock.lock();
+	}
+}
+
+void stats_dumper::_dump()
+{
+	// A failed write is skipped rather than stopping the simulation, and the next report still has the totals.
+	std::ofstream out(_path, std::ios::app);
+	write_stats_json(out, _stats->collect(), _label);
+	out << '\n';
+}
+
+#endif
@@ -0,0 +1,296 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <immintrin.h>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// Instrumentation of cpu_executor, compiled in by defining GOL_INSTRUMENT. Without it, executor_stats and the timers
+// are empty classes whose functions do nothing, and the executor only calls them from if constexpr blocks, so it
+// compiles to the same code as if they weren't there.
+#ifdef GOL_INSTRUMENT
+inline constexpr bool instrumentation_enabled = true;
+#else
+inline constexpr bool instrumentation_enabled = false;
+#endif
+
+enum class phase : std::uint8_t {
+	// Updating tiles, over all the generations of a pass, including counting their cells.
+	update,
+	// Waiting at the end of a pass for the other threads.
+	barrier,
+	// Timed by the executor's caller with phase_timer, between passes.
+	load_next,
+	snapshot
+};
+
+inline constexpr std::size_t phase_count = 4;
+
+char const* phase_name(phase p);
+
+
+struct cell_census {
+	std::uint64_t population;
+	std::uint64_t births;
+	std::uint64_t deaths;
+};
+
+// Counts the cells written by an updater, from the old and new states it has in registers. Vectors of cells are summed
+// into 64 bit lanes, which are only added together by add_to().
+class census_accumulator {
+public:
+	census_accumulator();
+
+	void add_cell(bool old_state, bool new_state);
+	// 32 cells of one byte each, which are 0 or 1.
+	void add_cells(__m256i old_states, __m256i new_states);
+	// Bit packed cells.
+	void add_word(std::uint64_t old_states, std::uint64_t new_states);
+	void add_words(__m256i old_states, __m256i new_states);
+
+	// Adds the population of the new states, and the cells born and died, to census.
+	void add_to(cell_census& census) const;
+
+private:
+	__m256i _population;
+	__m256i _births;
+	__m256i _deaths;
+	cell_census _scalar;
+
+	static __m256i _sum_bytes(__m256i v);
+	static __m256i _popcount(__m256i v);
+	static std::uint64_t _sum_lanes(__m256i v);
+};
+
+// Takes the place of census_accumulator when the cells aren't counted, and compiles to nothing.
+class null_census {
+public:
+	void add_cell(bool, bool) {}
+	void add_cells(__m256i, __m256i) {}
+	void add_word(std::uint64_t, std::uint64_t) {}
+	void add_words(__m256i, __m256i) {}
+};
+
+
+// Queue of fixed capacity for one producer thread and one consumer thread. Neither end ever blocks or locks: push()
+// fails, and counts the item as dropped, if the queue is full.
+template<class T>
+class spsc_ring {
+public:
+	// The capacity is rounded up to a power of 2.
+	spsc_ring(std::size_t capacity);
+
+	bool push(T const& item);
+	bool pop(T& item);
+	// Copies the item pop() would remove, without removing it.
+	bool peek(T& item) const;
+
+	std::uint64_t dropped() const;
+
+private:
+	std::vector<T> _items;
+	std::size_t _mask;
+	// Next indices to push and pop, each only written by one end.
+	alignas(64) std::atomic_size_t _head;
+	std::atomic_uint64_t _dropped;
+	alignas(64) std::atomic_size_t _tail;
+};
+
+
+struct phase_sample {
+	// Number of passes ended by the end of the sample, counting the pass it is part of.
+	std::uint64_t passes;
+	std::uint64_t ns;
+	phase kind;
+};
+
+struct pass_sample {
+	// Generations advanced by the executor by the end of the pass, and in the pass.
+	std::uint64_t generation;
+	std::uint64_t generations;
+	std::uint64_t active_tiles;
+	// Population at the end of the pass, and births and deaths in the last generation of the pass. They are counted
+	// by the updaters as they write the last generation.
+	cell_census census;
+	// Time spent updating by the busiest thread, and on average.
+	std::uint64_t max_busy_ns;
+	std::uint64_t mean_busy_ns;
+};
+
+struct phase_totals {
+	std::uint64_t count;
+	std::uint64_t total_ns;
+	std::uint64_t max_ns;
+};
+
+struct stats_report {
+	std::uint64_t passes;
+	std::uint64_t generations;
+	// Per thread, per phase totals since the executor was made.
+	std::vector<std::array<phase_totals, phase_count>> threads;
+	// A pass's barrier imbalance is the fraction of the busiest thread's time that the average thread spends waiting
+	// for it: 1 - mean_busy / max_busy.
+	double mean_imbalance;
+	double max_imbalance;
+	// Samples lost because a ring buffer filled up before they were collected.
+	std::uint64_t dropped_samples;
+	// Passes since the last report.
+	std::vector<pass_sample> recent_passes;
+};
+
+// Writes a report as a single line of JSON, with the label first if there is one.
+void write_stats_json(std::ostream& out, stats_report const& report, std::string const& label = {});
+
+
+#ifdef GOL_INSTRUMENT
+
+// Records the phases of each pass of a cpu_executor. Each thread adds up its phase times for a pass in its own slot,
+// and pushes them into its own ring buffer once the pass is over, so nothing is shared between threads until the end
+// of the pass, when thread 0 works out the barrier imbalance and census. The other threads push their samples after
+// thread 0 has ended the pass, so collect() waits for them, and holds back the samples of passes it doesn't report
+// yet.
+class executor_stats {
+public:
+	static inline constexpr std::size_t default_ring_capacity = 1 << 14;
+
+	executor_stats(std::size_t num_threads, std::size_t ring_capacity = default_ring_capacity);
+
+	// Used by the executor. begin_pass() and end_pass() are called by thread 0 while the other threads are waiting for
+	// the next pass, and each thread calls the functions in between with its own index only.
+	void begin_pass(std::size_t num_tiles);
+	void begin_thread_pass(std::size_t thread_idx);
+	void add_time(std::size_t thread_idx, phase p, std::uint64_t ns);
+	void add_census(std::size_t thread_idx, std::size_t tile, cell_census const& census);
+	void end_thread_pass(std::size_t thread_idx);
+	void end_pass(std::size_t generations, std::size_t active_tiles);
+	// Records a phase outside the executor's passes, from thread 0: the thread which calls the executor.
+	void record(phase p, std::uint64_t ns);
+
+	// Drains the ring buffers into a report. Can be called from any thread, while the executor's threads are running.
+	stats_report collect();
+
+private:
+	struct alignas(64) thread_slot {
+		std::uint64_t pass;
+		std::array<std::uint64_t, phase_count> ns;
+		std::uint64_t births;
+		std::uint64_t deaths;
+		// Number of passes whose samples the thread has pushed.
+		std::atomic_uint64_t published;
+	};
+
+	std::vector<thread_slot> _slots;
+	std::vector<std::unique_ptr<spsc_ring<phase_sample>>> _rings;
+	// Only used by thread 0.
+	std::uint64_t _pass;
+	std::uint64_t _generation;
+	// Population of each tile's next state, which stays valid for tiles skipped by a pass.
+	std::vector<std::uint64_t> _tile_population;
+	spsc_ring<pass_sample> _pass_ring;
+	// Totals so far, only used by collect().
+	std::mutex _collect_mutex;
+	stats_report _report;
+	double _imbalance_sum;
+};
+
+// Adds the time between laps to the current pass of a thread.
+class lap_timer {
+public:
+	lap_timer(executor_stats& stats, std::size_t thread_idx);
+
+	void lap(phase p);
+
+private:
+	executor_stats* _stats;
+	std::size_t _thread_idx;
+	std::chrono::steady_clock::time_point _last;
+};
+
+// Records the time from construction to destruction as a phase outside the executor's passes.
+class phase_timer {
+public:
+	~phase_timer();
+	phase_timer(executor_stats& stats, phase p);
+	phase_timer(phase_timer const&) = delete;
+	phase_timer& operator=(phase_timer const&) = delete;
+
+private:
+	executor_stats* _stats;
+	phase _phase;
+	std::chrono::steady_clock::time_point _start;
+};
+
+// Appends a line of JSON with a report to a file at an interval, and once more when destroyed, from a background
+// thread.
+class stats_dumper {
+public:
+	~stats_dumper();
+	// The label goes in every line, to tell apart the executors sharing a file. Throws std::runtime_error if the file
+	// can't be opened.
+	stats_dumper(executor_stats& stats, std::filesystem::path const& path,
+		std::chrono::milliseconds interval = std::chrono::seconds(1), std::string label = {});
+
+private:
+	executor_stats* _stats;
+	std::chrono::milliseconds _interval;
+	std::filesystem::path _path;
+	std::string _label;
+	std::mutex _mutex;
+	std::condition_variable _cond;
+	bool _exit;
+	std::thread _thread;
+
+	void _thread_func();
+	void _dump();
+};
+
+#else
+
+class executor_stats {
+public:
+	executor_stats(std::size_t, std::size_t = 0) {}
+
+	void begin_pass(std::size_t) {}
+	void begin_thread_pass(std::size_t) {}
+	void add_time(std::size_t, phase, std::uint64_t) {}
+	void add_census(std::size_t, std::size_t, cell_census const&) {}
+	void end_thread_pass(std::size_t) {}
+	void end_pass(std::size_t, std::size_t) {}
+	void record(phase, std::uint64_t) {}
+
+	stats_report collect() { return {}; }
+};
+
+class lap_timer {
+public:
+	lap_timer(executor_stats&, std::size_t) {}
+
+	void lap(phase) {}
+};
+
+class phase_timer {
+public:
+	phase_timer(executor_stats&, phase) {}
+};
+
+class stats_dumper {
+public:
+	stats_dumper(executor_stats&, std::filesystem::path const&,
+		std::chrono::milliseconds = std::chrono::seconds(1), std::string = {}) {}
+};
+
+#endif
+
+
+#include "instrument.tpp"
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <immintrin.h>
+#include <vector>
+
+
+// census_accumulator is called from the updaters' inner loops, so it is defined here to be inlined.
+inline census_accumulator::census_accumulator() :
+	_population(_mm256_setzero_si256()),
+	_births(_mm256_setzero_si256()),
+	_deaths(_mm256_setzero_si256()),
+	_scalar{0, 0, 0}
+{}
+
+inline void census_accumulator::add_cell(bool old_state, bool new_state)
+{
+	_scalar.population += new_state;
+	_scalar.births += new_state && !old_state;
+	_scalar.deaths += old_state && !new_state;
+}
+
+inline void census_accumulator::add_cells(__m256i old_states, __m256i new_states)
+{
+	_population = _mm256_add_epi64(_population, _sum_bytes(new_states));
+	_births = _mm256_add_epi64(_births, _sum_bytes(_mm256_andnot_si256(old_states, new_states)));
+	_deaths = _mm256_add_epi64(_deaths, _sum_bytes(_mm256_andnot_si256(new_states, old_states)));
+}
+
+inline void census_accumulator::add_word(std::uint64_t old_states, std::uint64_t new_states)
+{
+	_scalar.population += static_cast<std::uint64_t>(_mm_popcnt_u64(new_states));
+	_scalar.births += static_cast<std::uint64_t>(_mm_popcnt_u64(new_states & ~old_states));
+	_scalar.deaths += static_cast<std::uint64_t>(_mm_popcnt_u64(old_states & ~new_states));
+}
+
+inline void census_accumulator::add_words(__m256i old_states, __m256i new_states)
+{
+	_population = _mm256_add_epi64(_population, _popcount(new_states));
+	_births = _mm256_add_epi64(_births, _popcount(_mm256_andnot_si256(old_states, new_states)));
+	_deaths = _mm256_add_epi64(_deaths, _popcount(_mm256_andnot_si256(new_states, old_states)));
+}
+
+inline void census_accumulator::add_to(cell_census& census) const
+{
+	census.population += _scalar.population + _sum_lanes(_population);
+	census.births += _scalar.births + _sum_lanes(_births);
+	census.deaths += _scalar.deaths + _sum_lanes(_deaths);
+}
+
+inline __m256i census_accumulator::_sum_bytes(__m256i v)
+{
+	// Sums the bytes of each 64 bit lane.
+	return _mm256_sad_epu8(v, _mm256_setzero_si256());
+}
+
+inline __m256i census_accumulator::_popcount(__m256i v)
+{
+	// Counts the set bits of each 64 bit lane, by looking up the count of each nibble.
+	__m256i const lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+		0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+	__m256i const low_mask = _mm256_set1_epi8(0x0F);
+	__m256i const low = _mm256_shuffle_epi8(lut, _mm256_and_si256(v, low_mask));
+	__m256i const high = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask));
+	return _sum_bytes(_mm256_add_epi8(low, high));
+}
+
+inline std::uint64_t census_accumulator::_sum_lanes(__m256i v)
+{
+	__m128i const sum = _mm_add_epi64(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+	return static_cast<std::uint64_t>(_mm_cvtsi128_si64(sum))
+		+ static_cast<std::uint64_t>(_mm_cvtsi128_si64(_mm_unpackhi_epi64(sum, sum)));
+}
+
+
+template<class T>
+spsc_ring<T>::spsc_ring(std::size_t capacity) :
+	_head(0),
+	_dropped(0),
+	_tail(0)
+{
+	std::size_t size = 1;
+	while (size < capacity) {
+		size *= 2;
+	}
+	_items.resize(size);
+	_mask = size - 1;
+}
+
+template<class T>
+bool spsc_ring<T>::push(T const& item)
+{
+	std::size_t const head = _head.load(std::memory_order_relaxed);
+	if (head - _tail.load(std::memory_order_acquire) == _items.size()) {
+		_dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	_items[head & _mask] = item;
+	_head.store(head + 1, std::memory_order_release);
+	return true;
+}
+
+template<class T>
+bool spsc_ring<T>::pop(T& item)
+{
+	std::size_t const tail = _tail.load(std::memory_order_relaxed);
+	if (tail == _head.load(std::memory_order_acquire)) {
+		return false;
+	}
+	item = _items[tail & _mask];
+	_tail.store(tail + 1, std::memory_order_release);
+	return true;
+}
+
+template<class T>
+bool spsc_ring<T>::peek(T& item) const
+{
+	std::size_t const tail = _tail.load(std::memory_order_relaxed);
+	if (tail == _head.load(std::memory_order_acquire)) {
+		return false;
+	}
+	item = _items[tail & _mask];
+	return true;
+}
+
+template<class T>
+std::uint64_t spsc_ring<T>::dropped() const
+{
+	return _dropped.load(std::memory_order_relaxed);
+}
@@ -1,83 +1,229 @@
 #include "execution.hpp"
 #include "grid.hpp"
+#include "instrument.hpp"
+#include "pattern.hpp"
+#include "pipeline.hpp"
 #include "render.hpp"
+#include "rule.hpp"
+#include "snapshot.hpp"
 #include "update.hpp"
 #include "utility.hpp"
 
+#include <algorithm>
 #include <atomic>
-#include <chrono>
 #include <cstddef>
-#include <iostream>
-#include <ratio>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
 #define NOMINMAX
 #include <Windows.h>
 
 
-//#define BENCHMARK
-constexpr std::size_t benchmark_iterations = 2500ull;
+// Stores 1 bit per cell instead of 1 byte, and updates whole words of cells at once.
+//#define PACKED_ENGINE
 
-#ifdef BENCHMARK
-constexpr std::size_t rows = 2000;
-constexpr std::size_t cols = 2000;
-#else
-constexpr std::size_t rows = 800;
-constexpr std::size_t cols = 800;
-#endif
-constexpr std::size_t num_threads = 1;
+// Command line: [<rows> <cols> [<threads>]] [<file>] [--checkpoint <file> [--checkpoint-interval <generations>]].
+// The default number of threads is std::thread::hardware_concurrency(). The grid starts from a snapshot if the file has
+// the .gol extension, or a pattern in the middle of the grid otherwise, and runs the rule given in the file. Without a
+// file the grid is random and runs Conway's Game of Life.
+// Without dimensions, a snapshot's grid has the snapshot's dimensions, and a pattern's grid is the pattern padded by
+// pattern_padding cells on each side, and at least the default dimensions. Without either, the default dimensions are
+// used.
+// With --checkpoint, a snapshot is written to the file every checkpoint interval from a background thread, and once
+// more when the window is closed. Passing it as the file resumes the run from the same generation.
+// Frames are rendered by a render_pipeline, so the simulation runs at full speed and the window shows the latest
+// generation whenever it is ready for a frame. Grids larger than the screen are downsampled to fit.
+// Benchmarks are run headless with gol_bench instead.
+// Builds with GOL_INSTRUMENT append the executor's statistics to this file every second (see instrument.hpp).
+constexpr char const* stats_path = "gol_stats.jsonl";
+
+constexpr std::size_t default_rows = 800;
+constexpr std::size_t default_cols = 800;
+constexpr std::size_t pattern_padding = 64;
+constexpr std::size_t default_checkpoint_interval = 10000;
 
 
-int wWinMain(HINSTANCE, HINSTANCE, PWSTR, int)
+struct run_options {
+	std::size_t rows = 0;
+	std::size_t cols = 0;
+	std::size_t num_threads = default_num_threads();
+	life_rule rule = conway_life;
+	std::filesystem::path start_path;
+	pattern start_pattern;
+	std::filesystem::path checkpoint_path;
+	std::size_t checkpoint_interval = default_checkpoint_interval;
+};
+
+
+template<std::size_t Rows, std::size_t Cols, std::uint16_t Birth, std::uint16_t Survival>
+void run(run_options const& options)
 {
-#ifdef BENCHMARK
-	std::cout << "Rows: " << rows << std::endl;
-	std::cout << "Columns: " << cols << std::endl;
-	std::cout << "Cells: " << rows * cols << std::endl;
-	std::cout << "Iterations: " << benchmark_iterations << std::endl;
-	std::cout << "Total cell updates: " << rows * cols * benchmark_iterations << std::endl;
-	std::cout << "Threads: " << num_threads << std::endl;
+#ifdef PACKED_ENGINE
+	using grid_type = packed_grid<Rows, Cols>;
+	using updater_type = packed_state_updater<Rows, Cols, Birth, Survival>;
+#else
+	using grid_type = game_grid<Rows, Cols>;
+	using updater_type = state_updater<Rows, Cols, Birth, Survival>;
 #endif
 
-	game_grid<rows, cols> grid;
-	grid.rand_init();
+	std::size_t const rows = options.rows;
+	std::size_t const cols = options.cols;
+	grid_type grid(rows, cols);
+	std::uint64_t generation = 0;
+	if (options.start_path.empty()) {
+		grid.rand_init();
+	}
+	else if (options.start_path.extension() == ".gol") {
+		generation = load_snapshot(options.start_path, grid).generation;
+	}
+	else {
+		place_pattern(grid, options.start_pattern);
+	}
+
+	auto const screen_rows = static_cast<std::size_t>(std::max(GetSystemMetrics(SM_CYSCREEN), 1));
+	auto const screen_cols = static_cast<std::size_t>(std::max(GetSystemMetrics(SM_CXSCREEN), 1));
+	std::size_t const downsample = std::max(frame_size(rows, screen_rows), frame_size(cols, screen_cols));
 
-#ifdef BENCHMARK
-	null_renderer renderer{};
-#else
 	std::atomic_bool exit_flag = false;
-	window_renderer renderer(grid, [&](){ exit_flag = true; });
-#endif
-	state_updater updater(grid);
-	cpu_executor<rows, cols, decltype(renderer), num_threads> executor(grid, updater, renderer);
+	window_renderer renderer(frame_size(rows, downsample), frame_size(cols, downsample), [&](){ exit_flag = true; });
+	updater_type updater(grid, options.rule);
+	cpu_executor<updater_type> executor(grid, updater, options.num_threads);
+	render_pipeline<grid_type, window_renderer> pipeline(grid, renderer, downsample);
+	stats_dumper dumper(executor.stats(), stats_path);
+	checkpoint_writer checkpoints;
+	std::string const rule = rule_string(options.rule);
 
-#ifdef BENCHMARK
-	auto const t1 = std::chrono::high_resolution_clock::now();
-	for (std::size_t n = 0; n < benchmark_iterations; ++n) {
-#else
+	pipeline.begin_snapshot(generation);
 	while (!exit_flag) {
-#endif
-		executor.render_and_update();
-		renderer.draw();
-		grid.load_next();
-	}
-
-#ifdef BENCHMARK
-	auto const t2 = std::chrono::high_resolution_clock::now();
-	auto const total_real_time = std::chrono::duration_cast<std::chrono::duration<double, std::ratio<1>>>(t2 - t1);
-	auto const real_time_per_iter = total_real_time / benchmark_iterations;
-	auto const real_time_per_cell = real_time_per_iter / (rows * cols);
-	auto const total_cpu_time = total_real_time * num_threads;
-	auto const cpu_time_per_iter = total_cpu_time / benchmark_iterations;
-	auto const cpu_time_per_cell = cpu_time_per_iter / (rows * cols);
-
-	std::cout << "Total real time: " << total_real_time.count() << "s" << std::endl;
-	std::cout << "Total CPU time: " << total_cpu_time.count() << "s" << std::endl;
-	std::cout << "Iterations per real second: " << 1.0 / real_time_per_iter.count() << std::endl;
-	std::cout << "Iterations per CPU second: " << 1.0 / cpu_time_per_iter.count() << std::endl;
-	std::cout << "Cell updates per real second: " << 1.0 / real_time_per_cell.count() << std::endl;
-	std::cout << "Cell updates per CPU second: " << 1.0 / cpu_time_per_cell.count() << std::endl;
-	std::cout << "Real time per cell update: " <<
-		std::chrono::duration_cast<std::chrono::duration<double, std::nano>>(real_time_per_cell).count() << "ns" << std::endl;
-	std::cout << "CPU time per cell update: " <<
-		std::chrono::duration_cast<std::chrono::duration<double, std::nano>>(cpu_time_per_cell).count() << "ns" << std::endl;
-#endif
+		executor.step();
+		{
+			phase_timer timer(executor.stats(), phase::snapshot);
+			pipeline.end_snapshot();
+		}
+		{
+			phase_timer timer(executor.stats(), phase::load_next);
+			grid.load_next();
+		}
+		++generation;
+		// If the last checkpoint is still being written, this one is skipped rather than waited for.
+		if (!options.checkpoint_path.empty() && generation % options.checkpoint_interval == 0) {
+			phase_timer timer(executor.stats(), phase::snapshot);
+			checkpoints.write(options.checkpoint_path, grid, generation, rule);
+		}
+		pipeline.begin_snapshot(generation);
+	}
+	pipeline.end_snapshot();
+
+	if (!options.checkpoint_path.empty()) {
+		checkpoints.wait();
+		checkpoints.write(options.checkpoint_path, grid, generation, rule);
+		checkpoints.wait();
+	}
+}
+
+// Returns false if the argument isn't a whole number.
+bool parse_count(std::wstring const& arg, std::size_t& count)
+{
+	if (arg.empty() || !std::all_of(arg.begin(), arg.end(), [](wchar_t c) { return c >= L'0' && c <= L'9'; })) {
+		return false;
+	}
+	count = static_cast<std::size_t>(std::stoull(arg));
+	return true;
+}
+
+void run_command_line(std::vector<std::wstring> const& args)
+{
+	run_options options;
+
+	// The dimensions and thread count come first if given, so the first argument which isn't a number is the file.
+	std::size_t arg_idx = 0;
+	if (args.size() >= 2 && parse_count(args[0], options.rows) && parse_count(args[1], options.cols)) {
+		arg_idx = 2;
+		if (arg_idx < args.size() && parse_count(args[arg_idx], options.num_threads)) {
+			++arg_idx;
+		}
+	}
+	else {
+		options.rows = 0;
+		options.cols = 0;
+	}
+	if (options.num_threads == 0) {
+		options.num_threads = default_num_threads();
+	}
+	if (arg_idx < args.size() && args[arg_idx].rfind(L"--", 0) != 0) {
+		options.start_path = args[arg_idx++];
+	}
+	for (; arg_idx < args.size(); ++arg_idx) {
+		std::wstring const& option = args[arg_idx];
+		if (arg_idx + 1 >= args.size()) {
+			throw std::invalid_argument("Missing value for a command line option.");
+		}
+		std::wstring const& value = args[++arg_idx];
+		if (option == L"--checkpoint") {
+			options.checkpoint_path = value;
+		}
+		else if (option == L"--checkpoint-interval") {
+			if (!parse_count(value, options.checkpoint_interval) || options.checkpoint_interval == 0) {
+				throw std::invalid_argument("Checkpoint interval must be a number of generations of at least 1.");
+			}
+		}
+		else {
+			throw std::invalid_argument("Unknown command line argument.");
+		}
+	}
+
+	// Files are read here, as the rule and size they give are needed before the grid is made.
+	std::filesystem::path const& path = options.start_path;
+	if (path.extension() == ".gol") {
+		snapshot_info const info = read_snapshot_info(path);
+		options.rule = parse_rule(info.rule);
+		if (options.rows == 0) {
+			options.rows = info.rows;
+			options.cols = info.cols;
+		}
+	}
+	else if (!path.empty()) {
+		options.start_pattern = load_pattern(path);
+		options.rule = parse_rule(options.start_pattern.rule);
+		if (options.rows == 0) {
+			options.rows = std::max(options.start_pattern.rows + 2 * pattern_padding, default_rows);
+			options.cols = std::max(options.start_pattern.cols + 2 * pattern_padding, default_cols);
+		}
+	}
+	if (options.rows == 0) {
+		options.rows = default_rows;
+		options.cols = default_cols;
+	}
+
+	dispatch_dims(options.rows, options.cols, [&](auto rows_c, auto cols_c) {
+		dispatch_rule(options.rule, [&](auto birth_c, auto survival_c) {
+			run<decltype(rows_c)::value, decltype(cols_c)::value, decltype(birth_c)::value,
+				decltype(survival_c)::value>(options);
+		});
+	});
+}
+
+int wWinMain(HINSTANCE, HINSTANCE, PWSTR cmd_line, int)
+{
+	// Arguments are separated by spaces, and can be quoted to include spaces.
+	std::vector<std::wstring> args;
+	std::wistringstream cmd_stream(cmd_line);
+	for (std::wstring arg; cmd_stream >> std::quoted(arg);) {
+		args.push_back(arg);
+	}
+
+	// There is no console to report errors to.
+	try {
+		run_command_line(args);
+	}
+	catch (std::exception const& e) {
+		MessageBoxA(NULL, e.what(), "Game of Life", MB_OK | MB_ICONERROR);
+		return 1;
+	}
+	return 0;
 }
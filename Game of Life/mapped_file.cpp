@@ -0,0 +1,111 @@
+#include "mapped_file.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <stdexcept>
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+#ifdef _WIN32
+
+mapped_file::~mapped_file()
+{
+	if (_data != nullptr) {
+		UnmapViewOfFile(_data);
+	}
+	if (_mapping != NULL) {
+		CloseHandle(_mapping);
+	}
+	CloseHandle(_file);
+}
+
+mapped_file::mapped_file(std::filesystem::path const& path) :
+	_data(nullptr),
+	_size(0),
+	_file(INVALID_HANDLE_VALUE),
+	_mapping(NULL)
+{
+	_file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (_file == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error("Failed to open " + path.string());
+	}
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(_file, &size)) {
+		CloseHandle(_file);
+		throw std::runtime_error("Failed to get the size of " + path.string());
+	}
+	_size = static_cast<std::size_t>(size.QuadPart);
+	if (_size == 0) {
+		return;
+	}
+
+	_mapping = CreateFileMappingW(_file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (_mapping != NULL) {
+		_data = static_cast<std::uint8_t const*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+	}
+	if (_data == nullptr) {
+		if (_mapping != NULL) {
+			CloseHandle(_mapping);
+		}
+		CloseHandle(_file);
+		throw std::runtime_error("Failed to map " + path.string());
+	}
+}
+
+#else
+
+mapped_file::~mapped_file()
+{
+	if (_data != nullptr) {
+		munmap(const_cast<std::uint8_t*>(_data), _size);
+	}
+}
+
+mapped_file::mapped_file(std::filesystem::path const& path) :
+	_data(nullptr),
+	_size(0)
+{
+	int const fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw std::runtime_error("Failed to open " + path.string());
+	}
+	struct stat file_stat{};
+	if (fstat(fd, &file_stat) != 0) {
+		close(fd);
+		throw std::runtime_error("Failed to get the size of " + path.string());
+	}
+	_size = static_cast<std::size_t>(file_stat.st_size);
+	if (_size == 0) {
+		close(fd);
+		return;
+	}
+
+	// The mapping stays valid after the file is closed.
+	void* const data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		throw std::runtime_error("Failed to map " + path.string());
+	}
+	_data = static_cast<std::uint8_t const*>(data);
+}
+
+#endif
+
+std::uint8_t const* mapped_file::data() const
+{
+	return _data;
+}
+
+std::size_t mapped_file::size() const
+{
+	return _size;
+}
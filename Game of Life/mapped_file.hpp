@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+
+// Maps a whole file into memory, read only.
+class mapped_file {
+public:
+	~mapped_file();
+	// Throws std::runtime_error if the file can't be opened or mapped.
+	mapped_file(std::filesystem::path const& path);
+	mapped_file(mapped_file const&) = delete;
+	mapped_file& operator=(mapped_file const&) = delete;
+
+	// The mapping is page aligned. Null for an empty file.
+	std::uint8_t const* data() const;
+	std::size_t size() const;
+
+private:
+	std::uint8_t const* _data;
+	std::size_t _size;
+#ifdef _WIN32
+	// File and file mapping handles.
+	void* _file;
+	void* _mapping;
+#endif
+};
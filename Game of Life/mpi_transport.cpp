@@ -0,0 +1,75 @@
+#include "mpi_transport.hpp"
+#include "utility.hpp"
+
+#include <climits>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <mpi.h>
+
+
+namespace {
+
+// Tags of halos sent towards the next and previous strips, which keep them apart when both neighbours are the same
+// rank.
+constexpr int to_next_tag = 0;
+constexpr int to_prev_tag = 1;
+
+void check(int result, char const* what)
+{
+	if (result != MPI_SUCCESS) {
+		char message[MPI_MAX_ERROR_STRING];
+		int length = 0;
+		MPI_Error_string(result, message, &length);
+		throw std::runtime_error(std::string(what) + ": " + std::string(message, static_cast<std::size_t>(length)));
+	}
+}
+
+}
+
+
+mpi_transport::~mpi_transport()
+{
+	if (_pending) {
+		MPI_Waitall(static_cast<int>(_requests.size()), _requests.data(), MPI_STATUSES_IGNORE);
+	}
+}
+
+mpi_transport::mpi_transport(MPI_Comm comm) :
+	_comm(comm),
+	_pending(false)
+{
+	int rank = 0;
+	int size = 0;
+	check(MPI_Comm_rank(comm, &rank), "Failed to get MPI rank");
+	check(MPI_Comm_size(comm, &size), "Failed to get MPI size");
+	_prev_rank = (rank + size - 1) % size;
+	_next_rank = (rank + 1) % size;
+	_requests.fill(MPI_REQUEST_NULL);
+}
+
+void mpi_transport::start_exchange(void const* send_prev, void const* send_next, void* recv_prev, void* recv_next,
+	std::size_t bytes)
+{
+	debug_assert(!_pending);
+	if (bytes > static_cast<std::size_t>(INT_MAX)) {
+		throw std::invalid_argument("Halos are too large for an MPI message.");
+	}
+
+	// The receives are posted first, so that the halos can go straight into the grid.
+	int const count = static_cast<int>(bytes);
+	check(MPI_Irecv(recv_prev, count, MPI_BYTE, _prev_rank, to_next_tag, _comm, &_requests[0]),
+		"Failed to receive halo");
+	check(MPI_Irecv(recv_next, count, MPI_BYTE, _next_rank, to_prev_tag, _comm, &_requests[1]),
+		"Failed to receive halo");
+	check(MPI_Isend(send_prev, count, MPI_BYTE, _prev_rank, to_prev_tag, _comm, &_requests[2]), "Failed to send halo");
+	check(MPI_Isend(send_next, count, MPI_BYTE, _next_rank, to_next_tag, _comm, &_requests[3]), "Failed to send halo");
+	_pending = true;
+}
+
+void mpi_transport::finish_exchange()
+{
+	_pending = false;
+	check(MPI_Waitall(static_cast<int>(_requests.size()), _requests.data(), MPI_STATUSES_IGNORE),
+		"Failed to exchange halos");
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <mpi.h>
+
+
+// Exchanges halos with non-blocking MPI point to point messages, for strips on any number of machines. Strip i is rank
+// i of the communicator. MPI must be initialised before it is constructed.
+// How much of an exchange progresses while the strip is updated depends on the MPI implementation; most move
+// messages of halo size eagerly.
+class mpi_transport {
+public:
+	// Finishes any exchange in progress.
+	~mpi_transport();
+	mpi_transport(MPI_Comm comm = MPI_COMM_WORLD);
+	mpi_transport(mpi_transport const&) = delete;
+	mpi_transport& operator=(mpi_transport const&) = delete;
+
+	void start_exchange(void const* send_prev, void const* send_next, void* recv_prev, void* recv_next,
+		std::size_t bytes);
+	// Throws std::runtime_error if any of the messages fail.
+	void finish_exchange();
+
+private:
+	MPI_Comm _comm;
+	int _prev_rank;
+	int _next_rank;
+	std::array<MPI_Request, 4> _requests;
+	bool _pending;
+};
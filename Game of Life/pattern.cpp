@@ -0,0 +1,252 @@
+#include "pattern.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <istream>
+#include <iterator>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+
+namespace {
+
+// Longest line written in RLE files, as recommended by the format.
+constexpr std::size_t rle_line_length = 70;
+
+void strip_carriage_return(std::string& line)
+{
+	if (!line.empty() && line.back() == '\r') {
+		line.pop_back();
+	}
+}
+
+// Parses "x = <cols>, y = <rows>[, rule = <rule>]".
+void read_rle_header(std::string const& line, pattern& pat)
+{
+	std::string header;
+	std::remove_copy_if(line.begin(), line.end(), std::back_inserter(header),
+		[](unsigned char c) { return std::isspace(c); });
+
+	bool have_cols = false;
+	bool have_rows = false;
+	std::istringstream fields(header);
+	std::string field;
+	while (std::getline(fields, field, ',')) {
+		auto const equals = field.find('=');
+		if (equals == std::string::npos) {
+			throw std::invalid_argument("Invalid RLE header.");
+		}
+		std::string const key = field.substr(0, equals);
+		std::string const value = field.substr(equals + 1);
+		try {
+			if (key == "x") {
+				pat.cols = std::stoull(value);
+				have_cols = true;
+			}
+			else if (key == "y") {
+				pat.rows = std::stoull(value);
+				have_rows = true;
+			}
+			else if (key == "rule") {
+				pat.rule = value;
+			}
+		}
+		catch (std::logic_error const&) {
+			throw std::invalid_argument("Invalid RLE header.");
+		}
+	}
+	if (!have_cols || !have_rows) {
+		throw std::invalid_argument("RLE header must give x and y.");
+	}
+}
+
+}
+
+
+pattern read_rle(std::istream& in)
+{
+	pattern pat;
+	bool have_header = false;
+	std::string body;
+	std::string line;
+	while (body.find('!') == std::string::npos && std::getline(in, line)) {
+		strip_carriage_return(line);
+		if (line.empty() || line[0] == '#') {
+			continue;
+		}
+		if (!have_header) {
+			read_rle_header(line, pat);
+			have_header = true;
+		}
+		else {
+			body += line;
+		}
+	}
+	if (!have_header) {
+		throw std::invalid_argument("Missing RLE header.");
+	}
+
+	pat.cells.assign(pat.rows * pat.cols, 0);
+	std::size_t row = 0;
+	std::size_t col = 0;
+	std::size_t count = 0;
+	for (char const c : body) {
+		if (std::isdigit(static_cast<unsigned char>(c))) {
+			count = count * 10 + static_cast<std::size_t>(c - '0');
+			continue;
+		}
+		if (std::isspace(static_cast<unsigned char>(c))) {
+			continue;
+		}
+		if (c == '!') {
+			break;
+		}
+
+		std::size_t const run = count == 0 ? 1 : count;
+		count = 0;
+		if (c == '$') {
+			row += run;
+			col = 0;
+		}
+		else if (c == 'b' || c == '.') {
+			col += run;
+		}
+		else if (std::isalpha(static_cast<unsigned char>(c))) {
+			// Other states of multi-state rules are all treated as live.
+			if (row >= pat.rows || col + run > pat.cols) {
+				throw std::invalid_argument("RLE pattern is larger than its header.");
+			}
+			std::fill_n(pat.cells.begin() + row * pat.cols + col, run, std::uint8_t{1});
+			col += run;
+		}
+		else {
+			throw std::invalid_argument(std::string("Invalid character in RLE pattern: ") + c);
+		}
+	}
+	return pat;
+}
+
+void write_rle(std::ostream& out, pattern const& pat)
+{
+	out << "x = " << pat.cols << ", y = " << pat.rows << ", rule = " << pat.rule << '\n';
+
+	std::string line;
+	auto const write_run = [&](std::size_t run, char tag) {
+		std::string const item = (run > 1 ? std::to_string(run) : std::string()) + tag;
+		if (line.size() + item.size() > rle_line_length) {
+			out << line << '\n';
+			line.clear();
+		}
+		line += item;
+	};
+
+	// Dead cells at the end of a row are left out, and the ends of consecutive rows are combined into one run.
+	std::size_t row_ends = 0;
+	for (std::size_t row = 0; row < pat.rows; ++row) {
+		auto const row_begin = pat.cells.begin() + row * pat.cols;
+		auto const row_end = row_begin + pat.cols;
+		auto const last_live = std::find(std::make_reverse_iterator(row_end), std::make_reverse_iterator(row_begin),
+			std::uint8_t{1});
+		if (row > 0) {
+			++row_ends;
+		}
+		if (last_live.base() == row_begin) {
+			continue;
+		}
+
+		if (row_ends > 0) {
+			write_run(row_ends, '$');
+			row_ends = 0;
+		}
+		for (auto run_begin = row_begin; run_begin != last_live.base();) {
+			auto const run_end = std::find_if(run_begin, last_live.base(),
+				[state = *run_begin](std::uint8_t c) { return c != state; });
+			write_run(static_cast<std::size_t>(run_end - run_begin), *run_begin ? 'o' : 'b');
+			run_begin = run_end;
+		}
+	}
+	write_run(1, '!');
+	out << line << '\n';
+}
+
+pattern read_plaintext(std::istream& in)
+{
+	std::vector<std::string> lines;
+	std::string line;
+	while (std::getline(in, line)) {
+		strip_carriage_return(line);
+		if (!line.empty() && line[0] == '!') {
+			continue;
+		}
+		lines.push_back(line);
+	}
+
+	pattern pat;
+	pat.rows = lines.size();
+	for (auto const& row : lines) {
+		pat.cols = std::max(pat.cols, row.size());
+	}
+	pat.cells.assign(pat.rows * pat.cols, 0);
+	for (std::size_t row = 0; row < pat.rows; ++row) {
+		for (std::size_t col = 0; col < lines[row].size(); ++col) {
+			char const c = lines[row][col];
+			if (c == 'O' || c == '*') {
+				pat.cells[row * pat.cols + col] = 1;
+			}
+			else if (c != '.') {
+				throw std::invalid_argument(std::string("Invalid character in plaintext pattern: ") + c);
+			}
+		}
+	}
+	return pat;
+}
+
+void write_plaintext(std::ostream& out, pattern const& pat)
+{
+	for (std::size_t row = 0; row < pat.rows; ++row) {
+		for (std::size_t col = 0; col < pat.cols; ++col) {
+			out << (pat.cells[row * pat.cols + col] ? 'O' : '.');
+		}
+		out << '\n';
+	}
+}
+
+pattern load_pattern(std::filesystem::path const& path)
+{
+	std::ifstream in(path);
+	if (!in) {
+		throw std::runtime_error("Failed to open " + path.string());
+	}
+
+	auto const extension = path.extension();
+	if (extension == ".cells" || extension == ".txt") {
+		return read_plaintext(in);
+	}
+	else {
+		return read_rle(in);
+	}
+}
+
+void save_pattern(std::filesystem::path const& path, pattern const& pat)
+{
+	std::ofstream out(path);
+	if (!out) {
+		throw std::runtime_error("Failed to open " + path.string());
+	}
+
+	auto const extension = path.extension();
+	if (extension == ".cells" || extension == ".txt") {
+		write_plaintext(out, pat);
+	}
+	else {
+		write_rle(out, pat);
+	}
+	if (!out) {
+		throw std::runtime_error("Failed to write " + path.string());
+	}
+}
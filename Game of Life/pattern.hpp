@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+
+inline constexpr char const* conway_rule = "B3/S23";
+
+// A rectangle of cells read from or written to a pattern file.
+struct pattern {
+	std::size_t rows = 0;
+	std::size_t cols = 0;
+	// Row-major, 1 for live cells.
+	std::vector<std::uint8_t> cells;
+	std::string rule = conway_rule;
+};
+
+// Run length encoded patterns (usually .rle). Comment lines are skipped, and the rule is read from the header if given.
+pattern read_rle(std::istream& in);
+void write_rle(std::ostream& out, pattern const& pat);
+
+// Plaintext patterns (usually .cells), with a line of . and O per row. Lines starting with ! are comments.
+pattern read_plaintext(std::istream& in);
+void write_plaintext(std::ostream& out, pattern const& pat);
+
+// Reads or writes a pattern file, as plaintext if the extension is .cells or .txt, otherwise as RLE. Throws
+// std::runtime_error if the file can't be opened, and std::invalid_argument if it isn't a valid pattern.
+pattern load_pattern(std::filesystem::path const& path);
+void save_pattern(std::filesystem::path const& path, pattern const& pat);
+
+// Sets the current state of the cells of a grid covered by a pattern with its top left at (row, col), wrapping around
+// the edges of the grid. Other cells are left unchanged.
+template<class Grid>
+void place_pattern(Grid& grid, pattern const& pat, std::size_t row, std::size_t col);
+// Places a pattern in the middle of a grid.
+template<class Grid>
+void place_pattern(Grid& grid, pattern const& pat);
+// The current state of a whole grid as a pattern.
+template<class Grid>
+pattern grid_pattern(Grid const& grid);
+
+
+#include "pattern.tpp"
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+
+
+template<class Grid>
+void place_pattern(Grid& grid, pattern const& pat, std::size_t row, std::size_t col)
+{
+	for (std::size_t pat_row = 0; pat_row < pat.rows; ++pat_row) {
+		std::size_t const grid_row = (row + pat_row) % grid.rows();
+		for (std::size_t pat_col = 0; pat_col < pat.cols; ++pat_col) {
+			std::size_t const grid_col = (col + pat_col) % grid.cols();
+			grid.set_curr(grid_row * grid.cols() + grid_col, pat.cells[pat_row * pat.cols + pat_col] != 0);
+		}
+	}
+}
+
+template<class Grid>
+void place_pattern(Grid& grid, pattern const& pat)
+{
+	std::size_t const row = grid.rows() > pat.rows ? (grid.rows() - pat.rows) / 2 : 0;
+	std::size_t const col = grid.cols() > pat.cols ? (grid.cols() - pat.cols) / 2 : 0;
+	place_pattern(grid, pat, row, col);
+}
+
+template<class Grid>
+pattern grid_pattern(Grid const& grid)
+{
+	pattern pat;
+	pat.rows = grid.rows();
+	pat.cols = grid.cols();
+	pat.cells.resize(grid.size());
+	for (std::size_t idx = 0; idx < grid.size(); ++idx) {
+		pat.cells[idx] = grid.get_curr(idx);
+	}
+	return pat;
+}
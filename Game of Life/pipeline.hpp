@@ -0,0 +1,75 @@
+#pragma once
+
+#include "render.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// Renders frames of a grid on its own thread, so that displaying the grid doesn't hold up the simulation.
+// Between generations, begin_snapshot() has the render thread copy the grid's current state into its own buffer while
+// the next generation is updated, and end_snapshot() waits for the copy before the grid's buffers are swapped. The
+// render thread then expands the copy into pixels and passes them to the presenter (see render.hpp).
+// If the render thread is still busy with the last frame, or hasn't started the copy by end_snapshot(), the generation
+// is skipped, so the simulation never waits for the display and the presenter gets the latest generation it had time
+// for.
+template<class Grid, class Presenter>
+class render_pipeline {
+public:
+	// Finishes presenting the last frame.
+	~render_pipeline();
+	// If skip_frames is false, the simulation waits for the render thread instead of skipping, so every generation is
+	// presented.
+	render_pipeline(Grid const& grid, Presenter& presenter, std::size_t downsample = 1, bool skip_frames = true);
+
+	std::size_t frame_rows() const;
+	std::size_t frame_cols() const;
+
+	// Must be called between generations, and followed by end_snapshot() before the grid's current state changes.
+	// Returns false if the generation is skipped. Rethrows any exception from presenting the last frame.
+	bool begin_snapshot(std::uint64_t generation);
+	void end_snapshot();
+	// Waits for the last frame to be presented. Rethrows any exception from presenting it.
+	void flush();
+
+	std::uint64_t frames_presented() const;
+	std::uint64_t frames_skipped() const;
+
+private:
+	enum class stage {
+		idle,
+		requested,
+		snapshot,
+		present
+	};
+
+	Grid const* _grid;
+	Presenter* _presenter;
+	std::size_t _downsample;
+	bool _skip_frames;
+	mutable std::mutex _mutex;
+	std::condition_variable _cond;
+	stage _stage;
+	bool _exit;
+	// Generation of the frame being rendered.
+	std::uint64_t _generation;
+	std::uint64_t _frames_presented;
+	std::uint64_t _frames_skipped;
+	std::exception_ptr _error;
+	// Only used by the render thread.
+	std::vector<std::uint64_t> _words;
+	std::vector<std::uint32_t> _pixels;
+	std::thread _thread;
+
+	// Must be called with _mutex locked.
+	void _rethrow_error();
+	void _thread_func();
+};
+
+
+#include "pipeline.tpp"
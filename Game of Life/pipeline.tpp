@@ -0,0 +1,166 @@
+#pragma once
+
+#include "render.hpp"
+#include "snapshot.hpp"
+#include "utility.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+
+template<class Grid, class Presenter>
+render_pipeline<Grid, Presenter>::~render_pipeline()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_exit = true;
+	}
+	_cond.notify_all();
+	_thread.join();
+}
+
+template<class Grid, class Presenter>
+render_pipeline<Grid, Presenter>::render_pipeline(Grid const& grid, Presenter& presenter, std::size_t downsample,
+	bool skip_frames) :
+	_grid(&grid),
+	_presenter(&presenter),
+	_downsample(downsample),
+	_skip_frames(skip_frames),
+	_stage(stage::idle),
+	_exit(false),
+	_generation(0),
+	_frames_presented(0),
+	_frames_skipped(0),
+	_words(grid.rows() * snapshot_row_words(grid.cols())),
+	_pixels(frame_size(grid.rows(), std::max(downsample, std::size_t{1}))
+		* frame_size(grid.cols(), std::max(downsample, std::size_t{1})))
+{
+	if (downsample == 0) {
+		throw std::invalid_argument("Downsampling factor must be at least 1.");
+	}
+
+	_thread = std::thread(&render_pipeline::_thread_func, this);
+}
+
+template<class Grid, class Presenter>
+std::size_t render_pipeline<Grid, Presenter>::frame_rows() const
+{
+	return frame_size(_grid->rows(), _downsample);
+}
+
+template<class Grid, class Presenter>
+std::size_t render_pipeline<Grid, Presenter>::frame_cols() const
+{
+	return frame_size(_grid->cols(), _downsample);
+}
+
+template<class Grid, class Presenter>
+bool render_pipeline<Grid, Presenter>::begin_snapshot(std::uint64_t generation)
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	_rethrow_error();
+	if (_stage != stage::idle) {
+		if (_skip_frames) {
+			++_frames_skipped;
+			return false;
+		}
+		_cond.wait(lock, [this]() { return _stage == stage::idle; });
+		_rethrow_error();
+	}
+
+	_generation = generation;
+	_stage = stage::requested;
+	lock.unlock();
+	_cond.notify_all();
+	return true;
+}
+
+template<class Grid, class Presenter>
+void render_pipeline<Grid, Presenter>::end_snapshot()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	if (_stage == stage::requested && _skip_frames) {
+		++_frames_skipped;
+		_stage = stage::idle;
+		return;
+	}
+	_cond.wait(lock, [this]() { return _stage != stage::requested && _stage != stage::snapshot; });
+}
+
+template<class Grid, class Presenter>
+void render_pipeline<Grid, Presenter>::flush()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	_cond.wait(lock, [this]() { return _stage == stage::idle; });
+	_rethrow_error();
+}
+
+template<class Grid, class Presenter>
+std::uint64_t render_pipeline<Grid, Presenter>::frames_presented() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _frames_presented;
+}
+
+template<class Grid, class Presenter>
+std::uint64_t render_pipeline<Grid, Presenter>::frames_skipped() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _frames_skipped;
+}
+
+template<class Grid, class Presenter>
+void render_pipeline<Grid, Presenter>::_rethrow_error()
+{
+	if (_error) {
+		std::exception_ptr const error = _error;
+		_error = nullptr;
+		std::rethrow_exception(error);
+	}
+}
+
+template<class Grid, class Presenter>
+void render_pipeline<Grid, Presenter>::_thread_func()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (true) {
+		_cond.wait(lock, [this]() { return _stage == stage::requested || _exit; });
+		if (_stage != stage::requested) {
+			break;
+		}
+
+		// The grid's current state is left alone until the stage changes.
+		_stage = stage::snapshot;
+		lock.unlock();
+		pack_curr(*_grid, _words.data());
+		lock.lock();
+		std::uint64_t const generation = _generation;
+		_stage = stage::present;
+		_cond.notify_all();
+
+		lock.unlock();
+		std::exception_ptr error;
+		try {
+			expand_pixels(_words.data(), _grid->rows(), _grid->cols(), _downsample, _pixels.data());
+			_presenter->present(_pixels.data(), frame_rows(), frame_cols(), generation);
+		}
+		catch (...) {
+			error = std::current_exception();
+		}
+		lock.lock();
+
+		if (error) {
+			_error = error;
+		}
+		else {
+			++_frames_presented;
+		}
+		_stage = stage::idle;
+		_cond.notify_all();
+	}
+}
@@ -0,0 +1,150 @@
+#include "render.hpp"
+#include "utility.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <immintrin.h>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+
+namespace {
+
+constexpr std::size_t word_bits = 64;
+
+// Whether any of bits [begin, end) of a row are set.
+bool any_set(std::uint64_t const* row, std::size_t begin, std::size_t end)
+{
+	for (std::size_t word_idx = begin / word_bits; word_idx * word_bits < end; ++word_idx) {
+		std::size_t const word_begin = std::max(begin, word_idx * word_bits) - word_idx * word_bits;
+		std::size_t const word_end = std::min(end - word_idx * word_bits, word_bits);
+		std::uint64_t const mask = (word_end == word_bits ? ~std::uint64_t{0} : (std::uint64_t{1} << word_end) - 1)
+			& ~((std::uint64_t{1} << word_begin) - 1);
+		if ((row[word_idx] & mask) != 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void expand_row(std::uint64_t const* row, std::size_t cols, std::uint32_t* pixels)
+{
+	// Each byte of cells is broadcast to 8 lanes, and lane i tests bit i.
+	__m256i const bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+	__m256i const live_vec = _mm256_set1_epi32(static_cast<int>(live_pixel));
+	__m256i const dead_vec = _mm256_set1_epi32(static_cast<int>(dead_pixel));
+
+	std::size_t col = 0;
+	for (; col + 8 <= cols; col += 8) {
+		auto const cells = static_cast<int>((row[col / word_bits] >> (col % word_bits)) & 0xFFu);
+		__m256i const live = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(cells), bits), bits);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(pixels + col), _mm256_blendv_epi8(dead_vec, live_vec, live));
+	}
+	for (; col < cols; ++col) {
+		pixels[col] = ((row[col / word_bits] >> (col % word_bits)) & 1u) ? live_pixel : dead_pixel;
+	}
+}
+
+}
+
+
+std::size_t frame_size(std::size_t cells, std::size_t downsample)
+{
+	debug_assert(downsample >= 1);
+	return (cells + downsample - 1) / downsample;
+}
+
+void expand_pixels(std::uint64_t const* words, std::size_t rows, std::size_t cols, std::size_t downsample,
+	std::uint32_t* pixels)
+{
+	debug_assert(downsample >= 1);
+
+	std::size_t const row_words = (cols + word_bits - 1) / word_bits;
+	std::size_t const frame_rows = frame_size(rows, downsample);
+	std::size_t const frame_cols = frame_size(cols, downsample);
+	if (downsample == 1) {
+		for (std::size_t row = 0; row < rows; ++row) {
+			expand_row(words + row * row_words, cols, pixels + row * cols);
+		}
+		return;
+	}
+
+	// The rows of each block are combined, and then the columns, into a row of cells of the frame to be expanded.
+	std::vector<std::uint64_t> merged(row_words);
+	std::vector<std::uint64_t> frame_row((frame_cols + word_bits - 1) / word_bits);
+	for (std::size_t frame_row_idx = 0; frame_row_idx < frame_rows; ++frame_row_idx) {
+		std::size_t const row_begin = frame_row_idx * downsample;
+		std::size_t const row_end = std::min(row_begin + downsample, rows);
+		std::fill(merged.begin(), merged.end(), std::uint64_t{0});
+		for (std::size_t row = row_begin; row < row_end; ++row) {
+			for (std::size_t word_idx = 0; word_idx < row_words; ++word_idx) {
+				merged[word_idx] |= words[row * row_words + word_idx];
+			}
+		}
+
+		std::fill(frame_row.begin(), frame_row.end(), std::uint64_t{0});
+		for (std::size_t col = 0; col < frame_cols; ++col) {
+			if (any_set(merged.data(), col * downsample, std::min((col + 1) * downsample, cols))) {
+				frame_row[col / word_bits] |= std::uint64_t{1} << (col % word_bits);
+			}
+		}
+		expand_row(frame_row.data(), frame_cols, pixels + frame_row_idx * frame_cols);
+	}
+}
+
+
+frame_dump_renderer::frame_dump_renderer(std::filesystem::path directory, frame_format format) :
+	_directory(std::move(directory)),
+	_format(format),
+	_frames_written(0)
+{
+	std::error_code error;
+	std::filesystem::create_directories(_directory, error);
+	if (error) {
+		throw std::runtime_error("Failed to create " + _directory.string() + ": " + error.message());
+	}
+}
+
+void frame_dump_renderer::present(std::uint32_t const* pixels, std::size_t rows, std::size_t cols,
+	std::uint64_t generation)
+{
+	std::ostringstream name;
+	name << "frame_" << std::setw(10) << std::setfill('0') << generation
+		<< (_format == frame_format::ppm ? ".ppm" : ".raw");
+	auto const path = _directory / name.str();
+
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	if (!out) {
+		throw std::runtime_error("Failed to open " + path.string());
+	}
+	if (_format == frame_format::ppm) {
+		out << "P6\n" << cols << ' ' << rows << "\n255\n";
+		_buf.resize(rows * cols * 3);
+		for (std::size_t i = 0; i < rows * cols; ++i) {
+			_buf[3 * i] = static_cast<char>((pixels[i] >> 16) & 0xFFu);
+			_buf[3 * i + 1] = static_cast<char>((pixels[i] >> 8) & 0xFFu);
+			_buf[3 * i + 2] = static_cast<char>(pixels[i] & 0xFFu);
+		}
+		out.write(_buf.data(), static_cast<std::streamsize>(_buf.size()));
+	}
+	else {
+		out.write(reinterpret_cast<char const*>(pixels), static_cast<std::streamsize>(rows * cols * sizeof(*pixels)));
+	}
+	if (!out.flush()) {
+		throw std::runtime_error("Failed to write " + path.string());
+	}
+	++_frames_written;
+}
+
+std::size_t frame_dump_renderer::frames_written() const
+{
+	return _frames_written;
+}
@@ -1,77 +1,60 @@
 #pragma once
 
-#include "grid.hpp"
-
-#define NOMINMAX
-#include <array>
-#include <atlbase.h>
-#include <atomic>
 #include <cstddef>
 #include <cstdint>
-#include <d2d1.h>
-#include <functional>
-#include <thread>
+#include <filesystem>
 #include <vector>
-#include <Windows.h>
 
 
-template<std::size_t Rows, std::size_t Cols>
-class window_renderer {
+// Presenters display frames from a render_pipeline (see pipeline.hpp) with present(pixels, rows, cols, generation),
+// on the pipeline's own thread.
+// null_renderer is available everywhere. Presenters which display the grid are platform specific.
+class null_renderer {
 public:
-	~window_renderer();
-	window_renderer(game_grid<Rows, Cols> const& grid, std::function<void(void)> close_callback);
+	template<typename... Args>
+	void present(Args&&...) const {}
+};
 
-	void render(std::size_t begin_idx, std::size_t end_idx);
-	void draw() const;
 
-private:
-	// B8G8R8A8 pixel format.
-	static inline constexpr std::array<std::uint8_t, 4> _live_pixel = {0x00, 0xFF, 0x00, 0x00};
-	static inline constexpr std::array<std::uint8_t, 4> _dead_pixel = {0x00, 0x00, 0x00, 0x00};
+// B8G8R8A8 pixel format, as little endian 32 bit values.
+inline constexpr std::uint32_t live_pixel = 0x0000FF00;
+inline constexpr std::uint32_t dead_pixel = 0x00000000;
 
-	// Signals for the window to actually be destroyed and the window thread to exit.
-	static inline constexpr UINT _wm_definite_close = WM_USER;
+// Frames can be downsampled by a whole factor in both directions, with each pixel live if any of its cells are.
+std::size_t frame_size(std::size_t cells, std::size_t downsample);
+// Expands cells in the row layout of snapshots (see snapshot.hpp) into a frame of pixels. Each byte of cells is
+// expanded into 8 pixels at once.
+void expand_pixels(std::uint64_t const* words, std::size_t rows, std::size_t cols, std::size_t downsample,
+	std::uint32_t* pixels);
 
-	game_grid<Rows, Cols> const* _grid;
-	std::vector<std::uint32_t> _pixels;
-	HWND _window;
-	CComPtr<ID2D1HwndRenderTarget> _render_target;
-	CComPtr<ID2D1Bitmap> _bitmap;
-	std::thread _window_thread;
-	std::atomic_bool _window_ready;
-	std::function<void(void)> _close_callback;
 
-	void _window_func();
-	static LRESULT CALLBACK _window_proc(HWND window, UINT msg, WPARAM wparam, LPARAM lparam);
+enum class frame_format {
+	// Binary RGB PPM, which most image viewers can open.
+	ppm,
+	// The B8G8R8A8 pixels alone, without a header.
+	raw
 };
 
-template<std::size_t Rows, std::size_t Cols>
-class console_renderer {
+// Presenter which writes each frame to a file named after its generation in a directory, for running without a
+// display.
+class frame_dump_renderer {
 public:
-	console_renderer(game_grid<Rows, Cols> const& grid, HANDLE console_handle);
-
-	void render(std::size_t begin_idx, std::size_t end_idx);
-	void draw() const;
-
-private:
-	static inline constexpr char live_cell = 'x';
-	static inline constexpr char dead_cell = ' ';
-	static inline constexpr std::size_t _buf_size = Rows * (Cols + 1);
+	// Throws std::runtime_error if the directory can't be created.
+	frame_dump_renderer(std::filesystem::path directory, frame_format format = frame_format::ppm);
 
-	game_grid<Rows, Cols> const* _grid;
-	std::vector<char> _data;
-	HANDLE _console_handle;
+	// Throws std::runtime_error if the file can't be written.
+	void present(std::uint32_t const* pixels, std::size_t rows, std::size_t cols, std::uint64_t generation);
 
-	void _render(std::size_t grid_idx, std::size_t buf_idx);
-};
+	std::size_t frames_written() const;
 
-class null_renderer {
-public:
-	template<typename... Args>
-	void render(Args&&...) const {}
-	template<typename... Args>
-	void draw(Args&&...) const {}
+private:
+	std::filesystem::path _directory;
+	frame_format _format;
+	std::size_t _frames_written;
+	std::vector<char> _buf;
 };
 
 
-#include "render.tpp"
+#ifdef _WIN32
+#include "win32_render.hpp"
+#endif
@@ -0,0 +1,101 @@
+#include "rule.hpp"
+
+#include <cctype>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+
+namespace {
+
+constexpr std::uint16_t max_neighbours = 8;
+
+// Adds the neighbour counts in str[pos..] up to the next non-digit to mask.
+std::size_t read_counts(std::string const& str, std::size_t pos, std::uint16_t& mask)
+{
+	for (; pos < str.size() && std::isdigit(static_cast<unsigned char>(str[pos])); ++pos) {
+		auto const count = static_cast<std::uint16_t>(str[pos] - '0');
+		if (count > max_neighbours) {
+			throw std::invalid_argument("Invalid rule: " + str);
+		}
+		mask |= static_cast<std::uint16_t>(1u << count);
+	}
+	return pos;
+}
+
+std::string write_counts(std::uint16_t mask)
+{
+	std::string counts;
+	for (std::uint16_t count = 0; count <= max_neighbours; ++count) {
+		if ((mask >> count) & 1u) {
+			counts += static_cast<char>('0' + count);
+		}
+	}
+	return counts;
+}
+
+}
+
+
+life_rule parse_rule(std::string const& str)
+{
+	life_rule rule = {0, 0};
+	if (str.empty()) {
+		throw std::invalid_argument("Invalid rule: " + str);
+	}
+
+	if (std::isdigit(static_cast<unsigned char>(str[0])) || str[0] == '/') {
+		// S/B notation, with the survival counts first and no letters.
+		std::size_t pos = read_counts(str, 0, rule.survival);
+		if (pos == str.size() || str[pos] != '/') {
+			throw std::invalid_argument("Invalid rule: " + str);
+		}
+		pos = read_counts(str, pos + 1, rule.birth);
+		if (pos != str.size()) {
+			throw std::invalid_argument("Invalid rule: " + str);
+		}
+		return rule;
+	}
+
+	// B/S notation. Either part may come first, and the / between them is optional.
+	bool have_birth = false;
+	bool have_survival = false;
+	std::size_t pos = 0;
+	while (pos < str.size()) {
+		char const letter = static_cast<char>(std::toupper(static_cast<unsigned char>(str[pos])));
+		if (letter == 'B' && !have_birth) {
+			pos = read_counts(str, pos + 1, rule.birth);
+			have_birth = true;
+		}
+		else if (letter == 'S' && !have_survival) {
+			pos = read_counts(str, pos + 1, rule.survival);
+			have_survival = true;
+		}
+		else {
+			throw std::invalid_argument("Invalid rule: " + str);
+		}
+
+		if (pos < str.size() && str[pos] == '/' && pos + 1 < str.size()) {
+			++pos;
+		}
+	}
+	if (!have_birth || !have_survival) {
+		throw std::invalid_argument("Invalid rule: " + str);
+	}
+	return rule;
+}
+
+std::string rule_string(life_rule rule)
+{
+	return "B" + write_counts(rule.birth) + "/S" + write_counts(rule.survival);
+}
+
+
+rule_masks<dynamic_rule, dynamic_rule>::rule_masks(life_rule rule) :
+	_rule(rule)
+{
+	constexpr std::uint16_t all_counts = (1u << (max_neighbours + 1)) - 1;
+	if ((rule.birth & ~all_counts) != 0 || (rule.survival & ~all_counts) != 0) {
+		throw std::invalid_argument("Rule has neighbour counts above 8.");
+	}
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <tuple>
+
+
+// An outer-totalistic rule. Bit n of birth is set if a dead cell with n live neighbours becomes live, and bit n of
+// survival is set if a live cell with n live neighbours stays live.
+struct life_rule {
+	std::uint16_t birth;
+	std::uint16_t survival;
+};
+
+constexpr bool operator==(life_rule a, life_rule b) { return a.birth == b.birth && a.survival == b.survival; }
+constexpr bool operator!=(life_rule a, life_rule b) { return !(a == b); }
+
+inline constexpr life_rule conway_life = {1 << 3, 1 << 2 | 1 << 3};
+inline constexpr life_rule highlife = {1 << 3 | 1 << 6, 1 << 2 | 1 << 3};
+inline constexpr life_rule day_and_night = {
+	1 << 3 | 1 << 6 | 1 << 7 | 1 << 8,
+	1 << 3 | 1 << 4 | 1 << 6 | 1 << 7 | 1 << 8
+};
+inline constexpr life_rule seeds = {1 << 2, 0};
+
+// Parses a rule in B/S notation ("B36/S23"), or in the older S/B notation ("23/36"). Letters may be either case.
+// Throws std::invalid_argument if it isn't a valid rule.
+life_rule parse_rule(std::string const& str);
+// Formats a rule in B/S notation.
+std::string rule_string(life_rule rule);
+
+
+// Used for both Birth and Survival to make the rule a runtime value instead of template parameters.
+inline constexpr std::uint16_t dynamic_rule = std::numeric_limits<std::uint16_t>::max();
+
+template<std::uint16_t Birth, std::uint16_t Survival>
+class rule_masks {
+public:
+	static_assert(Birth < 1 << 9 && Survival < 1 << 9);
+
+	rule_masks() = default;
+	rule_masks(life_rule rule);
+
+	static constexpr std::uint16_t birth() { return Birth; }
+	static constexpr std::uint16_t survival() { return Survival; }
+	static constexpr life_rule rule() { return {Birth, Survival}; }
+};
+
+template<>
+class rule_masks<dynamic_rule, dynamic_rule> {
+public:
+	rule_masks(life_rule rule);
+
+	std::uint16_t birth() const { return _rule.birth; }
+	std::uint16_t survival() const { return _rule.survival; }
+	life_rule rule() const { return _rule; }
+
+private:
+	life_rule _rule;
+};
+
+// Rules which get a compile-time specialisation from dispatch_rule(). All other rules use dynamic_rule.
+using common_rules = std::tuple<rule_masks<conway_life.birth, conway_life.survival>,
+	rule_masks<highlife.birth, highlife.survival>, rule_masks<day_and_night.birth, day_and_night.survival>,
+	rule_masks<seeds.birth, seeds.survival>>;
+
+// Calls func(std::integral_constant<std::uint16_t, Birth>{}, std::integral_constant<std::uint16_t, Survival>{}) with
+// the matching common_rules entry, or with dynamic_rule if there is none.
+template<std::size_t RuleIdx = 0, class Func>
+void dispatch_rule(life_rule rule, Func&& func);
+
+
+#include "rule.tpp"
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+
+template<std::uint16_t Birth, std::uint16_t Survival>
+rule_masks<Birth, Survival>::rule_masks(life_rule rule)
+{
+	if (rule.birth != Birth || rule.survival != Survival) {
+		throw std::invalid_argument("Rule doesn't match the template arguments.");
+	}
+}
+
+
+template<std::size_t RuleIdx, class Func>
+void dispatch_rule(life_rule rule, Func&& func)
+{
+	if constexpr (RuleIdx < std::tuple_size_v<common_rules>) {
+		using masks = std::tuple_element_t<RuleIdx, common_rules>;
+		if (rule == masks::rule()) {
+			func(std::integral_constant<std::uint16_t, masks::birth()>{},
+				std::integral_constant<std::uint16_t, masks::survival()>{});
+		}
+		else {
+			dispatch_rule<RuleIdx + 1>(rule, std::forward<Func>(func));
+		}
+	}
+	else {
+		func(std::integral_constant<std::uint16_t, dynamic_rule>{},
+			std::integral_constant<std::uint16_t, dynamic_rule>{});
+	}
+}
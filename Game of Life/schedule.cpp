@@ -0,0 +1,43 @@
+#include "schedule.hpp"
+#include "utility.hpp"
+
+#include <atomic>
+#include <cstddef>
+
+
+tile_scheduler::tile_scheduler(std::size_t num_threads) :
+	_queues(num_threads)
+{
+	reset(0);
+}
+
+void tile_scheduler::reset(std::size_t num_tiles)
+{
+	auto const partitions = partition(num_tiles, _queues.size());
+	for (std::size_t i = 0; i < _queues.size(); ++i) {
+		_queues[i].next.store(partitions[i].first, std::memory_order_relaxed);
+		_queues[i].end = partitions[i].first + partitions[i].second;
+	}
+}
+
+bool tile_scheduler::next_tile(std::size_t thread_idx, std::size_t& tile)
+{
+	debug_assert(thread_idx < _queues.size());
+
+	for (std::size_t i = 0; i < _queues.size(); ++i) {
+		if (_take(_queues[(thread_idx + i) % _queues.size()], tile)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool tile_scheduler::_take(tile_queue& queue, std::size_t& tile)
+{
+	// Check first so that exhausted queues aren't incremented without bound by threads looking for work.
+	if (queue.next.load(std::memory_order_relaxed) >= queue.end) {
+		return false;
+	}
+	tile = queue.next.fetch_add(1, std::memory_order_relaxed);
+	return tile < queue.end;
+}
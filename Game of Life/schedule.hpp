@@ -0,0 +1,29 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+
+// Hands out tiles to threads for one generation. Each thread starts with its own contiguous run of tiles, and once
+// that is done steals the remaining tiles of other threads, so a slow thread doesn't hold up the others.
+class tile_scheduler {
+public:
+	tile_scheduler(std::size_t num_threads);
+
+	// Divides tiles [0, num_tiles) between the threads. Must not be called while any thread is in next_tile().
+	void reset(std::size_t num_tiles);
+	// Gets the next tile for a thread. Returns false once there are no tiles left.
+	bool next_tile(std::size_t thread_idx, std::size_t& tile);
+
+private:
+	// Aligned to a cache line so threads taking their own tiles don't contend.
+	struct alignas(64) tile_queue {
+		std::atomic_size_t next;
+		std::size_t end;
+	};
+
+	std::vector<tile_queue> _queues;
+
+	static bool _take(tile_queue& queue, std::size_t& tile);
+};
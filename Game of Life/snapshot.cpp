@@ -0,0 +1,322 @@
+#include "mapped_file.hpp"
+#include "snapshot.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+namespace {
+
+constexpr char snapshot_magic[8] = {'G', 'O', 'L', 'S', 'N', 'A', 'P', '\0'};
+constexpr std::uint32_t snapshot_version = 1;
+
+// Header fields, by byte offset.
+constexpr std::size_t magic_offset = 0;
+constexpr std::size_t version_offset = 8;
+constexpr std::size_t header_size_offset = 12;
+constexpr std::size_t rows_offset = 16;
+constexpr std::size_t cols_offset = 24;
+constexpr std::size_t generation_offset = 32;
+constexpr std::size_t rule_offset = 40;
+static_assert(rule_offset + snapshot_max_rule_size == snapshot_header_size);
+
+// Snapshots are only written and read on little endian machines (all with AVX2), so values are copied as they are.
+template<typename T>
+void write_field(std::array<char, snapshot_header_size>& header, std::size_t offset, T val)
+{
+	std::memcpy(header.data() + offset, &val, sizeof(val));
+}
+
+template<typename T>
+T read_field(std::uint8_t const* header, std::size_t offset)
+{
+	T val;
+	std::memcpy(&val, header + offset, sizeof(val));
+	return val;
+}
+
+std::array<char, snapshot_header_size> make_header(snapshot_info const& info)
+{
+	if (info.rule.size() >= snapshot_max_rule_size) {
+		throw std::invalid_argument("Rule is too long for a snapshot.");
+	}
+
+	std::array<char, snapshot_header_size> header{};
+	std::memcpy(header.data() + magic_offset, snapshot_magic, sizeof(snapshot_magic));
+	write_field(header, version_offset, snapshot_version);
+	write_field(header, header_size_offset, static_cast<std::uint32_t>(snapshot_header_size));
+	write_field(header, rows_offset, static_cast<std::uint64_t>(info.rows));
+	write_field(header, cols_offset, static_cast<std::uint64_t>(info.cols));
+	write_field(header, generation_offset, info.generation);
+	std::memcpy(header.data() + rule_offset, info.rule.data(), info.rule.size());
+	return header;
+}
+
+std::uintmax_t snapshot_size(snapshot_info const& info)
+{
+	return snapshot_header_size
+		+ static_cast<std::uintmax_t>(info.rows) * snapshot_row_words(info.cols) * sizeof(std::uint64_t);
+}
+
+
+// Writes the header and rows of a snapshot to a new file, and flushes it to the disk before returning. Then replaces
+// a file with it, making sure the rename itself is on the disk, so a crash leaves either the old or the new snapshot.
+#ifdef _WIN32
+
+void write_synced(std::filesystem::path const& path, std::array<char, snapshot_header_size> const& header,
+	std::uint64_t const* words, std::size_t size)
+{
+	HANDLE const file = CreateFileW(path.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error("Failed to open " + path.string());
+	}
+	auto const write_all = [file](char const* data, std::size_t count) {
+		while (count > 0) {
+			DWORD const chunk = static_cast<DWORD>(std::min<std::size_t>(count, DWORD{1} << 30));
+			DWORD written = 0;
+			if (!WriteFile(file, data, chunk, &written, NULL)) {
+				return false;
+			}
+			data += written;
+			count -= written;
+		}
+		return true;
+	};
+	bool ok = write_all(header.data(), header.size())
+		&& write_all(reinterpret_cast<char const*>(words), size)
+		&& FlushFileBuffers(file);
+	ok = CloseHandle(file) && ok;
+	if (!ok) {
+		throw std::runtime_error("Failed to write " + path.string());
+	}
+}
+
+void replace_synced(std::filesystem::path const& from, std::filesystem::path const& to)
+{
+	if (!MoveFileExW(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+		throw std::runtime_error("Failed to replace " + to.string());
+	}
+}
+
+#else
+
+void write_synced(std::filesystem::path const& path, std::array<char, snapshot_header_size> const& header,
+	std::uint64_t const* words, std::size_t size)
+{
+	int const fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		throw std::runtime_error("Failed to open " + path.string());
+	}
+	auto const write_all = [fd](char const* data, std::size_t count) {
+		while (count > 0) {
+			ssize_t const written = write(fd, data, count);
+			if (written < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				return false;
+			}
+			data += written;
+			count -= static_cast<std::size_t>(written);
+		}
+		return true;
+	};
+	bool ok = write_all(header.data(), header.size())
+		&& write_all(reinterpret_cast<char const*>(words), size)
+		&& fsync(fd) == 0;
+	ok = close(fd) == 0 && ok;
+	if (!ok) {
+		throw std::runtime_error("Failed to write " + path.string());
+	}
+}
+
+void replace_synced(std::filesystem::path const& from, std::filesystem::path const& to)
+{
+	std::error_code error;
+	std::filesystem::rename(from, to, error);
+	if (error) {
+		throw std::runtime_error("Failed to replace " + to.string() + ": " + error.message());
+	}
+
+	auto directory = to.parent_path();
+	if (directory.empty()) {
+		directory = ".";
+	}
+	int const fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd < 0) {
+		throw std::runtime_error("Failed to open " + directory.string());
+	}
+	// Some file systems can't sync directories, and don't need to.
+	bool const ok = fsync(fd) == 0 || errno == EINVAL;
+	close(fd);
+	if (!ok) {
+		throw std::runtime_error("Failed to sync " + directory.string());
+	}
+}
+
+#endif
+}
+
+
+std::size_t snapshot_row_words(std::size_t cols)
+{
+	return (cols + 63) / 64;
+}
+
+void save_snapshot(std::filesystem::path const& path, snapshot_info const& info, std::uint64_t const* words)
+{
+	auto const header = make_header(info);
+	auto temp_path = path;
+	temp_path += ".tmp";
+	write_synced(temp_path, header, words, info.rows * snapshot_row_words(info.cols) * sizeof(std::uint64_t));
+	replace_synced(temp_path, path);
+}
+
+void create_snapshot(std::filesystem::path const& path, snapshot_info const& info)
+{
+	auto const header = make_header(info);
+	{
+		std::ofstream out(path, std::ios::binary | std::ios::trunc);
+		if (!out) {
+			throw std::runtime_error("Failed to open " + path.string());
+		}
+		if (!out.write(header.data(), header.size()).flush()) {
+			throw std::runtime_error("Failed to write " + path.string());
+		}
+	}
+	// The rows are left as a hole in the file, which reads as zeros.
+	std::error_code error;
+	std::filesystem::resize_file(path, snapshot_size(info), error);
+	if (error) {
+		throw std::runtime_error("Failed to resize " + path.string() + ": " + error.message());
+	}
+}
+
+void write_snapshot_rows(std::filesystem::path const& path, snapshot_info const& info, std::size_t first_row,
+	std::size_t num_rows, std::uint64_t const* words)
+{
+	if (first_row > info.rows || num_rows > info.rows - first_row) {
+		throw std::invalid_argument("Rows are beyond the end of the snapshot.");
+	}
+
+	std::fstream out(path, std::ios::binary | std::ios::in | std::ios::out);
+	if (!out) {
+		throw std::runtime_error("Failed to open " + path.string());
+	}
+	std::size_t const row_bytes = snapshot_row_words(info.cols) * sizeof(std::uint64_t);
+	out.seekp(static_cast<std::streamoff>(snapshot_header_size + first_row * row_bytes));
+	out.write(reinterpret_cast<char const*>(words), static_cast<std::streamsize>(num_rows * row_bytes));
+	if (!out.flush()) {
+		throw std::runtime_error("Failed to write " + path.string());
+	}
+}
+
+snapshot_info read_snapshot_info(std::filesystem::path const& path)
+{
+	mapped_file const file(path);
+	return parse_snapshot(file.data(), file.size());
+}
+
+snapshot_info parse_snapshot(std::uint8_t const* data, std::size_t size)
+{
+	if (size < snapshot_header_size || std::memcmp(data + magic_offset, snapshot_magic, sizeof(snapshot_magic)) != 0) {
+		throw std::invalid_argument("Not a snapshot.");
+	}
+	if (read_field<std::uint32_t>(data, version_offset) != snapshot_version
+		|| read_field<std::uint32_t>(data, header_size_offset) != snapshot_header_size) {
+		throw std::invalid_argument("Unsupported snapshot version.");
+	}
+
+	snapshot_info info;
+	info.rows = static_cast<std::size_t>(read_field<std::uint64_t>(data, rows_offset));
+	info.cols = static_cast<std::size_t>(read_field<std::uint64_t>(data, cols_offset));
+	info.generation = read_field<std::uint64_t>(data, generation_offset);
+	auto const rule = reinterpret_cast<char const*>(data + rule_offset);
+	info.rule.assign(rule, std::find(rule, rule + snapshot_max_rule_size, '\0'));
+
+	std::size_t const row_words = snapshot_row_words(info.cols);
+	std::size_t const data_words = (size - snapshot_header_size) / sizeof(std::uint64_t);
+	if (row_words == 0 || info.rows > data_words / row_words) {
+		throw std::invalid_argument("Snapshot is truncated.");
+	}
+	return info;
+}
+
+
+checkpoint_writer::~checkpoint_writer()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_exit = true;
+	}
+	_cond.notify_all();
+	_thread.join();
+}
+
+checkpoint_writer::checkpoint_writer() :
+	_pending(false),
+	_exit(false),
+	_info{0, 0, 0, {}}
+{
+	_thread = std::thread(&checkpoint_writer::_thread_func, this);
+}
+
+void checkpoint_writer::wait()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	_cond.wait(lock, [this]() { return !_pending; });
+	_rethrow_error();
+}
+
+void checkpoint_writer::_rethrow_error()
+{
+	if (_error) {
+		std::exception_ptr const error = _error;
+		_error = nullptr;
+		std::rethrow_exception(error);
+	}
+}
+
+void checkpoint_writer::_thread_func()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (true) {
+		_cond.wait(lock, [this]() { return _pending || _exit; });
+		if (!_pending) {
+			break;
+		}
+
+		// write() doesn't touch the buffers while _pending is set.
+		lock.unlock();
+		std::exception_ptr error;
+		try {
+			save_snapshot(_path, _info, _words.data());
+		}
+		catch (...) {
+			error = std::current_exception();
+		}
+		lock.lock();
+
+		_error = error;
+		_pending = false;
+		_cond.notify_all();
+	}
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "grid.hpp"
+#include "pattern.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// Snapshot files hold the current state of a grid with 1 bit per cell. A 64 byte header, with the dimensions,
+// generation and rule, is followed by the rows laid out like packed_grid: each row starts on a new 64 bit word, with
+// the first cell in the least significant bit. All values are little endian.
+// Snapshots are loaded through a memory mapping, so the cells go straight from the page cache into the grid.
+struct snapshot_info {
+	std::size_t rows;
+	std::size_t cols;
+	std::uint64_t generation;
+	std::string rule;
+};
+
+inline constexpr std::size_t snapshot_header_size = 64;
+// Including the terminating null.
+inline constexpr std::size_t snapshot_max_rule_size = 24;
+
+std::size_t snapshot_row_words(std::size_t cols);
+
+// Copies rows [first_row, first_row + num_rows) of the current state of a grid to or from the row layout of snapshots.
+template<std::size_t Rows, std::size_t Cols>
+void pack_rows(game_grid<Rows, Cols> const& grid, std::size_t first_row, std::size_t num_rows, std::uint64_t* words);
+template<std::size_t Rows, std::size_t Cols>
+void pack_rows(packed_grid<Rows, Cols> const& grid, std::size_t first_row, std::size_t num_rows, std::uint64_t* words);
+template<std::size_t Rows, std::size_t Cols>
+void unpack_rows(std::uint64_t const* words, std::size_t first_row, std::size_t num_rows, game_grid<Rows, Cols>& grid);
+template<std::size_t Rows, std::size_t Cols>
+void unpack_rows(std::uint64_t const* words, std::size_t first_row, std::size_t num_rows,
+	packed_grid<Rows, Cols>& grid);
+// Copies the whole current state of a grid.
+template<class Grid>
+void pack_curr(Grid const& grid, std::uint64_t* words);
+template<class Grid>
+void unpack_curr(std::uint64_t const* words, Grid& grid);
+
+// The file is written under a temporary name, flushed to the disk and then renamed, so an existing snapshot is only
+// replaced once the new one is complete, even if the system crashes. Throws std::runtime_error on failure.
+template<class Grid>
+void save_snapshot(std::filesystem::path const& path, Grid const& grid, std::uint64_t generation,
+	std::string const& rule = conway_rule);
+void save_snapshot(std::filesystem::path const& path, snapshot_info const& info, std::uint64_t const* words);
+// For writing a snapshot in parts, such as from several processes: create_snapshot() writes the header with all cells
+// dead, and write_snapshot_rows() then overwrites rows [first_row, first_row + num_rows) in place. Throws
+// std::runtime_error on failure, and std::invalid_argument if the rows are beyond the end of the snapshot.
+void create_snapshot(std::filesystem::path const& path, snapshot_info const& info);
+void write_snapshot_rows(std::filesystem::path const& path, snapshot_info const& info, std::size_t first_row,
+	std::size_t num_rows, std::uint64_t const* words);
+
+// Throws std::runtime_error if the file can't be read, and std::invalid_argument if it isn't a valid snapshot or
+// doesn't match the grid's dimensions.
+snapshot_info read_snapshot_info(std::filesystem::path const& path);
+// Reads the header of a snapshot in memory, and checks that the rows follow it.
+snapshot_info parse_snapshot(std::uint8_t const* data, std::size_t size);
+template<class Grid>
+snapshot_info load_snapshot(std::filesystem::path const& path, Grid& grid);
+
+
+// Writes snapshots from a background thread, so that checkpoints of long runs don't hold up the executor. Only the
+// copy of the grid's state is made on the calling thread, which must be between generations.
+class checkpoint_writer {
+public:
+	// Finishes writing the last checkpoint.
+	~checkpoint_writer();
+	checkpoint_writer();
+
+	// Returns false, without copying the grid, if the last checkpoint is still being written. Rethrows any exception
+	// from writing the last checkpoint.
+	template<class Grid>
+	bool write(std::filesystem::path const& path, Grid const& grid, std::uint64_t generation,
+		std::string const& rule = conway_rule);
+	// Waits for the last checkpoint to be written. Rethrows any exception from writing it.
+	void wait();
+
+private:
+	std::mutex _mutex;
+	std::condition_variable _cond;
+	// Whether the fields below are waiting to be written, or being written.
+	bool _pending;
+	bool _exit;
+	std::filesystem::path _path;
+	snapshot_info _info;
+	std::vector<std::uint64_t> _words;
+	std::exception_ptr _error;
+	std::thread _thread;
+
+	// Must be called with _mutex locked.
+	void _rethrow_error();
+	void _thread_func();
+};
+
+
+#include "snapshot.tpp"
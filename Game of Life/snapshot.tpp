@@ -0,0 +1,145 @@
+#pragma once
+
+#include "grid.hpp"
+#include "mapped_file.hpp"
+#include "utility.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <immintrin.h>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+template<std::size_t Rows, std::size_t Cols>
+void pack_rows(game_grid<Rows, Cols> const& grid, std::size_t first_row, std::size_t num_rows, std::uint64_t* words)
+{
+	debug_assert(first_row + num_rows <= grid.rows());
+
+	// Cells are 0 or 1, so 32 at a time are compared with 0 and their sign bits gathered with movemask.
+	constexpr std::size_t vectorised_count = 32;
+	std::size_t const cols = grid.cols();
+	std::size_t const row_words = snapshot_row_words(cols);
+	std::fill_n(words, num_rows * row_words, std::uint64_t{0});
+
+	for (std::size_t row = 0; row < num_rows; ++row) {
+		std::uint8_t const* const cells = grid.curr() + (first_row + row) * cols;
+		std::uint64_t* const out = words + row * row_words;
+		std::size_t col = 0;
+		for (; col + vectorised_count <= cols; col += vectorised_count) {
+			__m256i const cells_vec = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(cells + col));
+			auto const live = static_cast<std::uint32_t>(
+				_mm256_movemask_epi8(_mm256_cmpgt_epi8(cells_vec, _mm256_setzero_si256())));
+			out[col / 64] |= static_cast<std::uint64_t>(live) << (col % 64);
+		}
+		for (; col < cols; ++col) {
+			out[col / 64] |= static_cast<std::uint64_t>(cells[col] != 0) << (col % 64);
+		}
+	}
+}
+
+template<std::size_t Rows, std::size_t Cols>
+void pack_rows(packed_grid<Rows, Cols> const& grid, std::size_t first_row, std::size_t num_rows, std::uint64_t* words)
+{
+	static_assert(packed_grid<Rows, Cols>::word_bits == 64);
+	debug_assert(first_row + num_rows <= grid.rows());
+	std::copy_n(grid.curr() + first_row * grid.row_words(), num_rows * grid.row_words(), words);
+}
+
+template<std::size_t Rows, std::size_t Cols>
+void unpack_rows(std::uint64_t const* words, std::size_t first_row, std::size_t num_rows, game_grid<Rows, Cols>& grid)
+{
+	debug_assert(first_row + num_rows <= grid.rows());
+
+	std::size_t const cols = grid.cols();
+	std::size_t const row_words = snapshot_row_words(cols);
+	for (std::size_t row = 0; row < num_rows; ++row) {
+		std::uint64_t const* const in = words + row * row_words;
+		std::uint8_t* const cells = grid.curr() + (first_row + row) * cols;
+		for (std::size_t col = 0; col < cols; ++col) {
+			cells[col] = static_cast<std::uint8_t>((in[col / 64] >> (col % 64)) & 1u);
+		}
+	}
+}
+
+template<std::size_t Rows, std::size_t Cols>
+void unpack_rows(std::uint64_t const* words, std::size_t first_row, std::size_t num_rows,
+	packed_grid<Rows, Cols>& grid)
+{
+	debug_assert(first_row + num_rows <= grid.rows());
+
+	std::size_t const row_words = grid.row_words();
+	std::copy_n(words, num_rows * row_words, grid.curr() + first_row * row_words);
+	// Keeps the unused bits at the end of each row 0, as the updaters need.
+	std::size_t const tail_bits = grid.cols() % 64;
+	if (tail_bits != 0) {
+		for (std::size_t row = first_row; row < first_row + num_rows; ++row) {
+			grid.curr()[(row + 1) * row_words - 1] &= (std::uint64_t{1} << tail_bits) - 1;
+		}
+	}
+}
+
+template<class Grid>
+void pack_curr(Grid const& grid, std::uint64_t* words)
+{
+	pack_rows(grid, 0, grid.rows(), words);
+}
+
+template<class Grid>
+void unpack_curr(std::uint64_t const* words, Grid& grid)
+{
+	unpack_rows(words, 0, grid.rows(), grid);
+}
+
+template<class Grid>
+void save_snapshot(std::filesystem::path const& path, Grid const& grid, std::uint64_t generation,
+	std::string const& rule)
+{
+	std::vector<std::uint64_t> words(grid.rows() * snapshot_row_words(grid.cols()));
+	pack_curr(grid, words.data());
+	save_snapshot(path, snapshot_info{grid.rows(), grid.cols(), generation, rule}, words.data());
+}
+
+template<class Grid>
+snapshot_info load_snapshot(std::filesystem::path const& path, Grid& grid)
+{
+	mapped_file const file(path);
+	snapshot_info info = parse_snapshot(file.data(), file.size());
+	if (info.rows != grid.rows() || info.cols != grid.cols()) {
+		throw std::invalid_argument("Snapshot dimensions differ from the grid.");
+	}
+	// The mapping is page aligned, so the rows are aligned for words.
+	unpack_curr(reinterpret_cast<std::uint64_t const*>(file.data() + snapshot_header_size), grid);
+	return info;
+}
+
+
+template<class Grid>
+bool checkpoint_writer::write(std::filesystem::path const& path, Grid const& grid, std::uint64_t generation,
+	std::string const& rule)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_rethrow_error();
+		if (_pending) {
+			return false;
+		}
+	}
+
+	// The writer thread doesn't touch the buffers until _pending is set.
+	_words.resize(grid.rows() * snapshot_row_words(grid.cols()));
+	pack_curr(grid, _words.data());
+	_path = path;
+	_info = snapshot_info{grid.rows(), grid.cols(), generation, rule};
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_pending = true;
+	}
+	_cond.notify_all();
+	return true;
+}
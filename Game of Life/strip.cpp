@@ -0,0 +1,39 @@
+#include "strip.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+
+
+std::size_t strip_halo_rows(std::size_t cols, std::size_t generations)
+{
+	// The updaters' halo of generations * (cols + 1) cells, rounded up to whole rows.
+	return generations + (generations + cols - 1) / cols;
+}
+
+grid_strip make_strip(std::size_t grid_rows, std::size_t cols, std::size_t num_strips, std::size_t strip_idx,
+	std::size_t generations_per_exchange)
+{
+	if (num_strips == 0 || strip_idx >= num_strips) {
+		throw std::invalid_argument("Strip index is out of range.");
+	}
+
+	grid_strip strip;
+	strip.grid_rows = grid_rows;
+	strip.cols = cols;
+	// The first grid_rows % num_strips strips get an extra row.
+	std::size_t const base_rows = grid_rows / num_strips;
+	std::size_t const extra_rows = grid_rows % num_strips;
+	strip.first_row = strip_idx * base_rows + std::min(strip_idx, extra_rows);
+	strip.rows = base_rows + (strip_idx < extra_rows ? 1 : 0);
+	strip.halo_rows = strip_halo_rows(cols, std::max(generations_per_exchange, std::size_t{1}));
+	if (strip.rows < strip.halo_rows) {
+		throw std::invalid_argument("Strips must have at least as many rows as their halos.");
+	}
+	return strip;
+}
+
+std::size_t strip_local_rows(grid_strip const& strip)
+{
+	return strip.rows + 2 * strip.halo_rows;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "snapshot.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+
+// A grid can be split into strips of whole rows, each advanced by its own process, which only holds the strip and halos
+// of rows copied from the strips either side. Since the last cell of each row is a neighbour of the first cell of the
+// next, rows are the natural unit: each strip only borders the strip before it and the strip after it, with the last
+// strip followed by the first.
+struct grid_strip {
+	std::size_t grid_rows;
+	std::size_t cols;
+	std::size_t first_row;
+	std::size_t rows;
+	// Rows of each halo, enough for the most generations between exchanges.
+	std::size_t halo_rows;
+};
+
+// Rows of each halo needed to advance a strip by several generations between exchanges. It is the same as the halo of
+// a block updated over several generations by the updaters.
+std::size_t strip_halo_rows(std::size_t cols, std::size_t generations);
+// Splits the rows of a grid as evenly as possible between strips. Throws std::invalid_argument if a strip would have
+// fewer rows than its halos.
+grid_strip make_strip(std::size_t grid_rows, std::size_t cols, std::size_t num_strips, std::size_t strip_idx,
+	std::size_t generations_per_exchange);
+// Rows of the grid holding a strip and its halos, with the strip's first row at row halo_rows.
+std::size_t strip_local_rows(grid_strip const& strip);
+
+
+// Advances a strip held in a grid of strip_local_rows() rows. At the start of each pass the transport starts exchanging
+// halos with the neighbouring strips, and the rows which don't depend on the halos are updated while it is in flight.
+// The rows next to the halos are updated once the exchange is finished. Each cell goes through the same updater as in
+// a single grid, so the result is exactly the same.
+// Transports implement:
+//   start_exchange(send_prev, send_next, recv_prev, recv_next, bytes), which starts sending bytes from send_prev to the
+//   previous strip and from send_next to the next strip, and receiving as many from each into recv_prev and
+//   recv_next. None of the buffers may be written until the exchange is finished.
+//   finish_exchange(), which waits for the exchange to complete, and throws std::runtime_error on failure.
+template<class Updater, class Transport>
+class strip_executor {
+public:
+	using grid_type = typename Updater::grid_type;
+
+	// Throws std::invalid_argument if the grid doesn't fit the strip.
+	strip_executor(grid_type& grid, Updater& updater, Transport& transport, grid_strip const& strip);
+
+	// Advances the strip by up to the generations per exchange it was made for, and writes the result to the next grid.
+	// The halos of the next grid are left stale until the next exchange.
+	void update(std::size_t generations = 1);
+
+private:
+	grid_type* _grid;
+	Updater* _updater;
+	Transport* _transport;
+	grid_strip _strip;
+};
+
+
+// Loads a strip's rows from a snapshot of the whole grid. Only the pages of the file holding the strip are read.
+// Throws like load_snapshot().
+template<class Grid>
+snapshot_info load_strip(std::filesystem::path const& path, grid_strip const& strip, Grid& grid);
+// Writes a strip's rows into a snapshot of the whole grid made by create_snapshot().
+template<class Grid>
+void save_strip(std::filesystem::path const& path, snapshot_info const& info, grid_strip const& strip,
+	Grid const& grid);
+
+
+#include "strip.tpp"
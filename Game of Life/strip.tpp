@@ -0,0 +1,87 @@
+#pragma once
+
+#include "mapped_file.hpp"
+#include "snapshot.hpp"
+#include "utility.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <stdexcept>
+#include <vector>
+
+
+template<class Updater, class Transport>
+strip_executor<Updater, Transport>::strip_executor(grid_type& grid, Updater& updater, Transport& transport,
+	grid_strip const& strip) :
+	_grid(&grid),
+	_updater(&updater),
+	_transport(&transport),
+	_strip(strip)
+{
+	if (grid.rows() != strip_local_rows(strip) || grid.cols() != strip.cols) {
+		throw std::invalid_argument("Grid dimensions differ from the strip's.");
+	}
+}
+
+template<class Updater, class Transport>
+void strip_executor<Updater, Transport>::update(std::size_t generations)
+{
+	debug_assert(strip_halo_rows(_strip.cols, generations) <= _strip.halo_rows);
+
+	if (generations == 0) {
+		return;
+	}
+
+	// The first and last halo_rows rows of the strip are sent to the strips either side, which send back the rows
+	// beyond its ends. Rows are contiguous in both grids, so the halos are sent straight from the grid.
+	auto* const curr = reinterpret_cast<std::uint8_t*>(_grid->curr());
+	std::size_t const row_bytes = _grid->row_bytes();
+	std::size_t const halo_rows = _strip.halo_rows;
+	std::size_t const rows = _strip.rows;
+	_transport->start_exchange(curr + halo_rows * row_bytes, curr + rows * row_bytes, curr,
+		curr + (halo_rows + rows) * row_bytes, halo_rows * row_bytes);
+
+	// Only rows within the halo for this many generations of the strip's ends depend on the halos.
+	std::size_t const cols = _strip.cols;
+	std::size_t const begin_idx = halo_rows * cols;
+	std::size_t const end_idx = (halo_rows + rows) * cols;
+	std::size_t const edge = strip_halo_rows(cols, generations) * cols;
+	bool const has_interior = end_idx - begin_idx > 2 * edge;
+	if (has_interior) {
+		_updater->update(begin_idx + edge, end_idx - edge, generations);
+	}
+
+	_transport->finish_exchange();
+	if (has_interior) {
+		_updater->update(begin_idx, begin_idx + edge, generations);
+		_updater->update(end_idx - edge, end_idx, generations);
+	}
+	else {
+		_updater->update(begin_idx, end_idx, generations);
+	}
+}
+
+
+template<class Grid>
+snapshot_info load_strip(std::filesystem::path const& path, grid_strip const& strip, Grid& grid)
+{
+	mapped_file const file(path);
+	snapshot_info info = parse_snapshot(file.data(), file.size());
+	if (info.rows != strip.grid_rows || info.cols != strip.cols || grid.rows() != strip_local_rows(strip)
+		|| grid.cols() != strip.cols) {
+		throw std::invalid_argument("Snapshot dimensions differ from the grid.");
+	}
+	auto const rows = reinterpret_cast<std::uint64_t const*>(file.data() + snapshot_header_size);
+	unpack_rows(rows + strip.first_row * snapshot_row_words(info.cols), strip.halo_rows, strip.rows, grid);
+	return info;
+}
+
+template<class Grid>
+void save_strip(std::filesystem::path const& path, snapshot_info const& info, grid_strip const& strip,
+	Grid const& grid)
+{
+	std::vector<std::uint64_t> words(strip.rows * snapshot_row_words(strip.cols));
+	pack_rows(grid, strip.halo_rows, strip.rows, words.data());
+	write_snapshot_rows(path, info, strip.first_row, strip.rows, words.data());
+}
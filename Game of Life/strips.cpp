@@ -0,0 +1,447 @@
+#include "grid.hpp"
+#include "mapped_file.hpp"
+#include "rule.hpp"
+#include "snapshot.hpp"
+#include "strip.hpp"
+#include "transport.hpp"
+#include "update.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+#ifdef GOL_WITH_MPI
+#include <mpi.h>
+#endif
+
+
+constexpr char const* usage =
+	"Usage: gol_strips [options]\n"
+	"Advances a grid split into strips of rows, one per process, which exchange halos with their neighbours.\n"
+	"  --processes <n>       Strips, each in its own forked process (default 2)\n"
+#ifdef GOL_WITH_MPI
+	"  --transport <name>    socket, or mpi for a strip per rank started by mpirun (default socket)\n"
+#endif
+	"  --size <size>         Grid size of the random start, <n> or <rows>x<cols> (default 1024)\n"
+	"  --seed <n>            Seed of the random start (default 1)\n"
+	"  --input <file>        Snapshot to start from instead\n"
+	"  --rule <rule>         Rule in B/S notation (default the snapshot's, or B3/S23)\n"
+	"  --engine <engine>     byte or packed (default byte)\n"
+	"  --generations <n>     Generations to advance (default 1000)\n"
+	"  --pass <n>            Generations per halo exchange (default 1)\n"
+	"  --output <file>       Snapshot to write the result to\n"
+	"  --socket-dir <dir>    Directory for the sockets (default a new one in the temporary directory)\n"
+	"  --verify              Check the result against a single process, which needs --output\n";
+
+
+struct strips_options {
+	std::size_t processes = 2;
+	std::string transport = "socket";
+	std::size_t rows = 1024;
+	std::size_t cols = 1024;
+	std::uint64_t seed = 1;
+	std::string input;
+	std::optional<life_rule> rule;
+	std::string engine = "byte";
+	std::size_t generations = 1000;
+	std::size_t generations_per_pass = 1;
+	std::string output;
+	std::string socket_dir;
+	bool verify = false;
+};
+
+
+std::uint64_t splitmix64(std::uint64_t& state)
+{
+	std::uint64_t z = (state += 0x9E3779B97F4A7C15u);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9u;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBu;
+	return z ^ (z >> 31);
+}
+
+// Each row is generated from the seed and its index, so the grid is the same however it is split.
+template<class Grid>
+void rand_init_strip(Grid& grid, grid_strip const& strip, std::uint64_t seed)
+{
+	std::size_t const row_words = snapshot_row_words(strip.cols);
+	std::vector<std::uint64_t> words(strip.rows * row_words);
+	for (std::size_t row = 0; row < strip.rows; ++row) {
+		std::uint64_t state = seed ^ (static_cast<std::uint64_t>(strip.first_row + row) << 32);
+		for (std::size_t word_idx = 0; word_idx < row_words; ++word_idx) {
+			words[row * row_words + word_idx] = splitmix64(state);
+		}
+	}
+	unpack_rows(words.data(), strip.halo_rows, strip.rows, grid);
+}
+
+template<class Grid>
+void init_strip(Grid& grid, grid_strip const& strip, strips_options const& options)
+{
+	if (options.input.empty()) {
+		rand_init_strip(grid, strip, options.seed);
+	}
+	else {
+		load_strip(options.input, strip, grid);
+	}
+}
+
+// Calls func with null pointers of the grid and updater types for the engine and rule.
+template<class Func>
+void dispatch_engine(std::string const& engine, life_rule rule, Func&& func)
+{
+	dispatch_rule(rule, [&](auto birth_c, auto survival_c) {
+		constexpr std::uint16_t Birth = decltype(birth_c)::value;
+		constexpr std::uint16_t Survival = decltype(survival_c)::value;
+		if (engine == "packed") {
+			func(static_cast<packed_grid<dynamic_extent, dynamic_extent>*>(nullptr),
+				static_cast<packed_state_updater<dynamic_extent, dynamic_extent, Birth, Survival>*>(nullptr));
+		}
+		else {
+			func(static_cast<game_grid<dynamic_extent, dynamic_extent>*>(nullptr),
+				static_cast<state_updater<dynamic_extent, dynamic_extent, Birth, Survival>*>(nullptr));
+		}
+	});
+}
+
+// Advances one strip, writes it to the output, and returns the time taken.
+template<class Transport>
+double run_strip(strips_options const& options, snapshot_info const& output_info, life_rule rule,
+	grid_strip const& strip, Transport& transport)
+{
+	double seconds = 0.0;
+	dispatch_engine(options.engine, rule, [&](auto* grid_ptr, auto* updater_ptr) {
+		using grid_type = std::remove_pointer_t<decltype(grid_ptr)>;
+		using updater_type = std::remove_pointer_t<decltype(updater_ptr)>;
+
+		grid_type grid(strip_local_rows(strip), strip.cols);
+		init_strip(grid, strip, options);
+		updater_type updater(grid, rule);
+		strip_executor<updater_type, Transport> executor(grid, updater, transport, strip);
+
+		auto const start = std::chrono::steady_clock::now();
+		for (std::size_t n = 0; n < options.generations; n += options.generations_per_pass) {
+			executor.update(std::min(options.generations_per_pass, options.generations - n));
+			grid.load_next();
+		}
+		seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		if (!options.output.empty()) {
+			save_strip(options.output, output_info, strip, grid);
+		}
+	});
+	return seconds;
+}
+
+void report(strips_options const& options, snapshot_info const& info, std::size_t num_strips, double seconds)
+{
+	std::cout << num_strips << " strips, " << options.engine << ' ' << info.rule << ' ' << info.rows << 'x' << info.cols
+		<< ", " << options.generations << " generations, " << options.generations_per_pass << " per exchange: "
+		<< seconds << " s, "
+		<< static_cast<double>(info.rows * info.cols) * static_cast<double>(options.generations) / seconds
+		<< " cells/s" << std::endl;
+}
+
+// Advances the whole grid with a single state_updater, and checks that the output matches.
+bool verify(strips_options const& options, snapshot_info const& info, life_rule rule)
+{
+	game_grid<dynamic_extent, dynamic_extent> grid(info.rows, info.cols);
+	init_strip(grid, grid_strip{info.rows, info.cols, 0, info.rows, 0}, options);
+	state_updater<dynamic_extent, dynamic_extent, dynamic_rule, dynamic_rule> updater(grid, rule);
+	for (std::size_t n = 0; n < options.generations; ++n) {
+		updater.update(0, grid.size());
+		grid.load_next();
+	}
+
+	std::vector<std::uint64_t> words(info.rows * snapshot_row_words(info.cols));
+	pack_curr(grid, words.data());
+	mapped_file const file(options.output);
+	parse_snapshot(file.data(), file.size());
+	auto const output = reinterpret_cast<std::uint64_t const*>(file.data() + snapshot_header_size);
+	bool const matches = std::equal(words.begin(), words.end(), output);
+	std::cout << (matches ? "Result matches a single process." : "Result differs from a single process!")
+		<< std::endl;
+	return matches;
+}
+
+// Throws std::invalid_argument if any strip is smaller than its halos, so that no strip starts exchanging with a
+// neighbour which is about to fail.
+void check_strips(snapshot_info const& info, std::size_t num_strips, std::size_t generations_per_pass)
+{
+	for (std::size_t strip_idx = 0; strip_idx < num_strips; ++strip_idx) {
+		make_strip(info.rows, info.cols, num_strips, strip_idx, generations_per_pass);
+	}
+}
+
+
+// Forks a process for each strip, connected by sockets.
+int run_socket_strips(strips_options const& options, snapshot_info const& input_info,
+	snapshot_info const& output_info, life_rule rule)
+{
+	std::filesystem::path socket_dir = options.socket_dir;
+	if (socket_dir.empty()) {
+		socket_dir = std::filesystem::temp_directory_path() / ("gol_strips_" + std::to_string(getpid()));
+	}
+	std::filesystem::create_directories(socket_dir);
+
+	std::vector<pid_t> children;
+	for (std::size_t strip_idx = 0; strip_idx < options.processes; ++strip_idx) {
+		pid_t const pid = fork();
+		if (pid < 0) {
+			std::cerr << "Failed to fork." << std::endl;
+			break;
+		}
+		if (pid == 0) {
+			int status = 0;
+			try {
+				grid_strip const strip = make_strip(input_info.rows, input_info.cols, options.processes, strip_idx,
+					options.generations_per_pass);
+				socket_transport transport(socket_dir, strip_idx, options.processes);
+				double const seconds = run_strip(options, output_info, rule, strip, transport);
+				if (strip_idx == 0) {
+					report(options, output_info, options.processes, seconds);
+				}
+			}
+			catch (std::exception const& e) {
+				std::cerr << "Strip " << strip_idx << ": " << e.what() << std::endl;
+				status = 1;
+			}
+			std::cout.flush();
+			_exit(status);
+		}
+		children.push_back(pid);
+	}
+
+	// A failed strip closes its sockets, so its neighbours fail too rather than waiting forever.
+	bool failed = children.size() != options.processes;
+	for (pid_t const pid : children) {
+		int status = 0;
+		if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+			failed = true;
+		}
+	}
+	if (options.socket_dir.empty()) {
+		std::error_code error;
+		std::filesystem::remove_all(socket_dir, error);
+	}
+
+	if (failed) {
+		return 1;
+	}
+	if (options.verify && !verify(options, input_info, rule)) {
+		return 1;
+	}
+	return 0;
+}
+
+#ifdef GOL_WITH_MPI
+// Runs a strip on each rank, with rank 0 creating the output and verifying it.
+int run_mpi_strips(strips_options const& options, snapshot_info const& input_info, snapshot_info const& output_info,
+	life_rule rule)
+{
+	MPI_Init(nullptr, nullptr);
+	int rank = 0;
+	int size = 0;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &size);
+	auto const strip_idx = static_cast<std::size_t>(rank);
+	auto const num_strips = static_cast<std::size_t>(size);
+
+	// Every rank checks all the strips, so they all stop before any exchange if one of them is too small.
+	try {
+		check_strips(input_info, num_strips, options.generations_per_pass);
+	}
+	catch (std::exception const& e) {
+		if (rank == 0) {
+			std::cerr << e.what() << std::endl;
+		}
+		MPI_Finalize();
+		return 1;
+	}
+
+	int status = 0;
+	try {
+		grid_strip const strip = make_strip(input_info.rows, input_info.cols, num_strips, strip_idx,
+			options.generations_per_pass);
+		if (rank == 0 && !options.output.empty()) {
+			create_snapshot(options.output, output_info);
+		}
+		MPI_Barrier(MPI_COMM_WORLD);
+
+		double seconds = 0.0;
+		{
+			mpi_transport transport;
+			seconds = run_strip(options, output_info, rule, strip, transport);
+		}
+		MPI_Barrier(MPI_COMM_WORLD);
+		if (rank == 0) {
+			report(options, output_info, num_strips, seconds);
+			if (options.verify && !verify(options, input_info, rule)) {
+				status = 1;
+			}
+		}
+	}
+	catch (std::exception const& e) {
+		std::cerr << "Rank " << rank << ": " << e.what() << std::endl;
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+
+	MPI_Finalize();
+	return status;
+}
+#endif
+
+
+std::size_t parse_count(std::string const& str)
+{
+	std::size_t pos = 0;
+	unsigned long long const val = std::stoull(str, &pos);
+	if (pos != str.size()) {
+		throw std::invalid_argument("Invalid number: " + str);
+	}
+	return static_cast<std::size_t>(val);
+}
+
+strips_options parse_options(int argc, char* argv[])
+{
+	strips_options options;
+	for (int i = 1; i < argc; ++i) {
+		std::string const option = argv[i];
+		if (option == "--verify") {
+			options.verify = true;
+			continue;
+		}
+		if (i + 1 >= argc) {
+			throw std::invalid_argument("Missing value for " + option);
+		}
+		std::string const value = argv[++i];
+
+		if (option == "--processes") {
+			options.processes = parse_count(value);
+		}
+		else if (option == "--transport") {
+			options.transport = value;
+		}
+		else if (option == "--size") {
+			auto const x = value.find('x');
+			if (x == std::string::npos) {
+				options.rows = options.cols = parse_count(value);
+			}
+			else {
+				options.rows = parse_count(value.substr(0, x));
+				options.cols = parse_count(value.substr(x + 1));
+			}
+		}
+		else if (option == "--seed") {
+			options.seed = parse_count(value);
+		}
+		else if (option == "--input") {
+			options.input = value;
+		}
+		else if (option == "--rule") {
+			options.rule = parse_rule(value);
+		}
+		else if (option == "--engine") {
+			options.engine = value;
+		}
+		else if (option == "--generations") {
+			options.generations = parse_count(value);
+		}
+		else if (option == "--pass") {
+			options.generations_per_pass = parse_count(value);
+		}
+		else if (option == "--output") {
+			options.output = value;
+		}
+		else if (option == "--socket-dir") {
+			options.socket_dir = value;
+		}
+		else {
+			throw std::invalid_argument("Unknown option: " + option);
+		}
+	}
+
+	if (options.processes == 0 || options.generations_per_pass == 0) {
+		throw std::invalid_argument("Processes and generations per pass must be at least 1.");
+	}
+	if (options.rows < 2 || options.cols < 2) {
+		throw std::invalid_argument("Grid dimensions must be at least 2.");
+	}
+	if (options.engine != "byte" && options.engine != "packed") {
+		throw std::invalid_argument("Unknown engine: " + options.engine);
+	}
+#ifdef GOL_WITH_MPI
+	if (options.transport != "socket" && options.transport != "mpi") {
+#else
+	if (options.transport != "socket") {
+#endif
+		throw std::invalid_argument("Unknown transport: " + options.transport);
+	}
+	if (options.verify && options.output.empty()) {
+		throw std::invalid_argument("--verify needs --output.");
+	}
+	return options;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc == 2 && std::string(argv[1]) == "--help") {
+		std::cout << usage;
+		return 0;
+	}
+
+	strips_options options;
+	snapshot_info input_info{0, 0, 0, conway_rule};
+	life_rule rule = conway_life;
+	try {
+		options = parse_options(argc, argv);
+		if (options.input.empty()) {
+			input_info.rows = options.rows;
+			input_info.cols = options.cols;
+		}
+		else {
+			input_info = read_snapshot_info(options.input);
+			rule = parse_rule(input_info.rule);
+		}
+		if (options.rule) {
+			rule = *options.rule;
+		}
+		// Checks that the strips are big enough before starting any processes. The number of MPI ranks isn't known
+		// until MPI is initialised, so run_mpi_strips() checks them itself.
+		if (options.transport == "socket") {
+			check_strips(input_info, options.processes, options.generations_per_pass);
+		}
+	}
+	catch (std::exception const& e) {
+		std::cerr << e.what() << '\n' << usage;
+		return 1;
+	}
+
+	snapshot_info output_info{input_info.rows, input_info.cols, input_info.generation + options.generations,
+		rule_string(rule)};
+	try {
+#ifdef GOL_WITH_MPI
+		if (options.transport == "mpi") {
+			return run_mpi_strips(options, input_info, output_info, rule);
+		}
+#endif
+		if (!options.output.empty()) {
+			create_snapshot(options.output, output_info);
+		}
+		return run_socket_strips(options, input_info, output_info, rule);
+	}
+	catch (std::exception const& e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+}
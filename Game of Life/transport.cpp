@@ -0,0 +1,268 @@
+#include "transport.hpp"
+#include "utility.hpp"
+
+#ifndef _WIN32
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+
+namespace {
+
+[[noreturn]] void throw_errno(std::string const& what)
+{
+	throw std::runtime_error(what + ": " + std::generic_category().message(errno));
+}
+
+sockaddr_un socket_address(std::filesystem::path const& directory, std::size_t strip_idx)
+{
+	std::string const path = (directory / ("strip_" + std::to_string(strip_idx) + ".sock")).string();
+	sockaddr_un address{};
+	address.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(address.sun_path)) {
+		throw std::runtime_error("Socket path is too long: " + path);
+	}
+	std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+	return address;
+}
+
+int make_socket()
+{
+	int const fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		throw_errno("Failed to create socket");
+	}
+	return fd;
+}
+
+void set_non_blocking(int fd)
+{
+	int const flags = fcntl(fd, F_GETFL);
+	if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+		throw_errno("Failed to make socket non-blocking");
+	}
+}
+
+// Part of an exchange in one direction on one socket.
+struct transfer {
+	int fd;
+	bool send;
+	char* data;
+	std::size_t remaining;
+};
+
+}
+
+
+socket_transport::~socket_transport()
+{
+	if (_thread.joinable()) {
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_cond.wait(lock, [this]() { return !_pending; });
+			_exit = true;
+		}
+		_cond.notify_all();
+		_thread.join();
+	}
+	if (_prev_fd >= 0) {
+		close(_prev_fd);
+	}
+	if (_next_fd >= 0) {
+		close(_next_fd);
+	}
+}
+
+socket_transport::socket_transport(std::filesystem::path const& directory, std::size_t strip_idx,
+	std::size_t num_strips, std::chrono::milliseconds timeout) :
+	_prev_fd(-1),
+	_next_fd(-1),
+	_pending(false),
+	_exit(false),
+	_send_prev(nullptr),
+	_send_next(nullptr),
+	_recv_prev(nullptr),
+	_recv_next(nullptr),
+	_bytes(0)
+{
+	if (num_strips == 0 || strip_idx >= num_strips) {
+		throw std::invalid_argument("Strip index is out of range.");
+	}
+
+	// Every strip listens before connecting, and a connection completes as soon as it is queued on the listening
+	// socket, so no strip waits on another to accept.
+	sockaddr_un const own_address = socket_address(directory, strip_idx);
+	sockaddr_un const next_address = socket_address(directory, (strip_idx + 1) % num_strips);
+	int const listen_fd = make_socket();
+	try {
+		unlink(own_address.sun_path);
+		if (bind(listen_fd, reinterpret_cast<sockaddr const*>(&own_address), sizeof(own_address)) < 0
+			|| listen(listen_fd, 1) < 0) {
+			throw_errno(std::string("Failed to listen on ") + own_address.sun_path);
+		}
+
+		_next_fd = make_socket();
+		auto const deadline = std::chrono::steady_clock::now() + timeout;
+		while (connect(_next_fd, reinterpret_cast<sockaddr const*>(&next_address), sizeof(next_address)) < 0) {
+			// The next strip's process may not have created its socket yet.
+			if ((errno != ENOENT && errno != ECONNREFUSED && errno != EINTR)
+				|| std::chrono::steady_clock::now() >= deadline) {
+				throw_errno(std::string("Failed to connect to ") + next_address.sun_path);
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+
+		pollfd listen_poll{listen_fd, POLLIN, 0};
+		auto const remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+			deadline - std::chrono::steady_clock::now());
+		if (poll(&listen_poll, 1, static_cast<int>(std::max(remaining.count(), std::int64_t{0}))) <= 0) {
+			throw std::runtime_error("Timed out waiting for the previous strip to connect.");
+		}
+		_prev_fd = accept(listen_fd, nullptr, nullptr);
+		if (_prev_fd < 0) {
+			throw_errno("Failed to accept connection from the previous strip");
+		}
+		set_non_blocking(_prev_fd);
+		set_non_blocking(_next_fd);
+	}
+	catch (...) {
+		close(listen_fd);
+		unlink(own_address.sun_path);
+		if (_next_fd >= 0) {
+			close(_next_fd);
+		}
+		if (_prev_fd >= 0) {
+			close(_prev_fd);
+		}
+		throw;
+	}
+	close(listen_fd);
+	unlink(own_address.sun_path);
+
+	_thread = std::thread(&socket_transport::_thread_func, this);
+}
+
+void socket_transport::start_exchange(void const* send_prev, void const* send_next, void* recv_prev, void* recv_next,
+	std::size_t bytes)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		debug_assert(!_pending);
+		_send_prev = send_prev;
+		_send_next = send_next;
+		_recv_prev = recv_prev;
+		_recv_next = recv_next;
+		_bytes = bytes;
+		_pending = true;
+	}
+	_cond.notify_all();
+}
+
+void socket_transport::finish_exchange()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	_cond.wait(lock, [this]() { return !_pending; });
+	if (_error) {
+		std::exception_ptr const error = _error;
+		_error = nullptr;
+		std::rethrow_exception(error);
+	}
+}
+
+void socket_transport::_thread_func()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (true) {
+		_cond.wait(lock, [this]() { return _pending || _exit; });
+		if (!_pending) {
+			break;
+		}
+
+		// start_exchange() isn't called again until _pending is cleared.
+		lock.unlock();
+		std::exception_ptr error;
+		try {
+			_exchange();
+		}
+		catch (...) {
+			error = std::current_exception();
+		}
+		lock.lock();
+
+		_error = error;
+		_pending = false;
+		_cond.notify_all();
+	}
+}
+
+void socket_transport::_exchange()
+{
+	std::array<transfer, 4> transfers = {{
+		{_prev_fd, true, const_cast<char*>(static_cast<char const*>(_send_prev)), _bytes},
+		{_next_fd, true, const_cast<char*>(static_cast<char const*>(_send_next)), _bytes},
+		{_prev_fd, false, static_cast<char*>(_recv_prev), _bytes},
+		{_next_fd, false, static_cast<char*>(_recv_next), _bytes}
+	}};
+
+	while (true) {
+		std::array<pollfd, 2> fds = {{{_prev_fd, 0, 0}, {_next_fd, 0, 0}}};
+		for (auto const& t : transfers) {
+			if (t.remaining > 0) {
+				fds[t.fd == _prev_fd ? 0 : 1].events |= t.send ? POLLOUT : POLLIN;
+			}
+		}
+		if (fds[0].events == 0 && fds[1].events == 0) {
+			break;
+		}
+		if (poll(fds.data(), fds.size(), -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			throw_errno("Failed to poll sockets");
+		}
+
+		for (auto& t : transfers) {
+			short const revents = fds[t.fd == _prev_fd ? 0 : 1].revents;
+			if (t.remaining == 0 || (revents & ((t.send ? POLLOUT : POLLIN) | POLLERR | POLLHUP)) == 0) {
+				continue;
+			}
+			ssize_t const n = t.send
+#ifdef MSG_NOSIGNAL
+				? send(t.fd, t.data, t.remaining, MSG_NOSIGNAL)
+#else
+				? send(t.fd, t.data, t.remaining, 0)
+#endif
+				: recv(t.fd, t.data, t.remaining, 0);
+			if (n < 0) {
+				if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+					continue;
+				}
+				throw_errno(t.send ? "Failed to send halo" : "Failed to receive halo");
+			}
+			if (n == 0 && !t.send) {
+				throw std::runtime_error("Neighbouring strip closed its connection.");
+			}
+			t.data += n;
+			t.remaining -= static_cast<std::size_t>(n);
+		}
+	}
+}
+
+#endif
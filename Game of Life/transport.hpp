@@ -0,0 +1,62 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+
+
+// Transports exchange the halos of strips (see strip.hpp) between processes.
+
+#ifndef _WIN32
+
+// Connects each strip to its neighbours with Unix domain sockets, for processes on the same machine. Exchanges are
+// carried out by a background thread with non-blocking sockets, so that they progress while the strip is updated and
+// the sends and receives in both directions can't deadlock.
+class socket_transport {
+public:
+	// Finishes any exchange in progress.
+	~socket_transport();
+	// Strip strip_idx of num_strips listens on a socket named after its index in the directory, which must be the same
+	// for all of them, and connects to the next strip's socket, waiting up to timeout for it to appear. Throws
+	// std::runtime_error if the connections can't be made.
+	socket_transport(std::filesystem::path const& directory, std::size_t strip_idx, std::size_t num_strips,
+		std::chrono::milliseconds timeout = std::chrono::seconds(60));
+	socket_transport(socket_transport const&) = delete;
+	socket_transport& operator=(socket_transport const&) = delete;
+
+	void start_exchange(void const* send_prev, void const* send_next, void* recv_prev, void* recv_next,
+		std::size_t bytes);
+	// Rethrows any exception from the exchange.
+	void finish_exchange();
+
+private:
+	// Connected to the previous and next strips. With a single strip, these are both ends of the same connection.
+	int _prev_fd;
+	int _next_fd;
+	std::mutex _mutex;
+	std::condition_variable _cond;
+	// Whether the fields below are waiting to be exchanged, or being exchanged.
+	bool _pending;
+	bool _exit;
+	void const* _send_prev;
+	void const* _send_next;
+	void* _recv_prev;
+	void* _recv_next;
+	std::size_t _bytes;
+	std::exception_ptr _error;
+	std::thread _thread;
+
+	void _thread_func();
+	void _exchange();
+};
+
+#endif
+
+
+#ifdef GOL_WITH_MPI
+#include "mpi_transport.hpp"
+#endif
@@ -1,38 +1,131 @@
 #pragma once
 
 #include "grid.hpp"
+#include "instrument.hpp"
+#include "rule.hpp"
 #include "utility.hpp"
 
 #include <array>
 #include <cstddef>
 #include <cstdint>
+#include <immintrin.h>
 #include <vector>
 
 
-template<std::size_t Rows, std::size_t Cols>
+// Birth and Survival are the masks of a life_rule. The rule can be chosen at runtime with dynamic_rule, at the cost of
+// a slower kernel than the one for a fixed rule.
+template<std::size_t Rows, std::size_t Cols, std::uint16_t Birth = conway_life.birth,
+	std::uint16_t Survival = conway_life.survival>
 class state_updater {
 public:
+	using grid_type = game_grid<Rows, Cols>;
+
 	state_updater(game_grid<Rows, Cols>& grid);
+	state_updater(game_grid<Rows, Cols>& grid, life_rule rule);
 
-	void precomp(std::size_t begin_idx, std::size_t end_idx);
-	void update(std::size_t begin_idx, std::size_t end_idx);
+	// Returns true if any of the cells changed state.
+	bool update(std::size_t begin_idx, std::size_t end_idx);
+	// Also adds the population of the updated cells, and the cells born and died, to census.
+	bool update(std::size_t begin_idx, std::size_t end_idx, cell_census& census);
+	// Advances cells [begin_idx, end_idx) by several generations in one pass over the grid, and writes the result to
+	// the next grid. The cells and a halo around them are copied into a thread local block, which is updated in place
+	// with the halo shrinking each generation.
+	void update(std::size_t begin_idx, std::size_t end_idx, std::size_t generations);
+	// Also adds the population of the result, and the cells born and died in the last generation, to census.
+	void update(std::size_t begin_idx, std::size_t end_idx, std::size_t generations, cell_census& census);
 
 private:
+	using neighbour_offsets = std::array<std::ptrdiff_t, 8>;
+
 	static inline constexpr std::size_t _vectorised_count = 256 / 8;
-	static inline constexpr std::size_t _neighbours_align = _vectorised_count;
-	static inline constexpr std::array<std::ptrdiff_t, 8> _neighbour_offsets{
-		-std::ptrdiff_t{Cols} - 1, -std::ptrdiff_t{Cols}, -std::ptrdiff_t{Cols} + 1,
-		-1,												  1,
-		Cols - 1,				   Cols,				  Cols + 1
-	};
 
 	game_grid<Rows, Cols>* _grid;
-	std::vector<std::array<std::size_t, _neighbour_offsets.size()>> _neighbour_lut;
-	aligned_array<std::uint8_t, _neighbours_align> _neighbours;
+	rule_masks<Birth, Survival> _rule;
+
+	// Cells closer than this to either end of the grid have neighbours which wrap around to the other end.
+	std::size_t _wrap_margin() const;
+	neighbour_offsets _neighbour_offsets() const;
+	// Census is census_accumulator or null_census, and counts the cells as they are written.
+	template<class Census>
+	bool _update(std::size_t begin_idx, std::size_t end_idx, Census& census);
+	template<class Census>
+	void _update(std::size_t begin_idx, std::size_t end_idx, std::size_t generations, Census& census);
+	// The update functions return whether any cells changed state. _vectorised_update() returns the changes as a mask.
+	template<class Census>
+	bool _single_update(std::size_t grid_idx, Census& census);
+	// Updates cells whose neighbours are all within the buffer, without wrapping. The new state of curr[begin_idx] is
+	// written to out[0].
+	template<class Census>
+	bool _interior_update(std::uint8_t const* curr, std::uint8_t* out, std::size_t begin_idx, std::size_t end_idx,
+		neighbour_offsets const& offsets, Census& census) const;
+	// Conway's rule is applied with compares. Other rules look up the new states in the luts, which hold the birth and
+	// survival masks with one byte per neighbour count, repeated in each lane.
+	template<class Census>
+	static __m256i _vectorised_update(std::uint8_t const* curr, std::uint8_t* out, std::size_t grid_idx,
+		neighbour_offsets const& offsets, __m256i birth_lut, __m256i survival_lut, Census& census);
+	bool _next_state(bool state, std::uint8_t neighbours) const;
+};
+
+// Updates a packed_grid directly on its words. The 8 neighbours of each bit are summed with bit-sliced full adders,
+// so a whole word of cells is updated at once and no neighbour counts are stored.
+template<std::size_t Rows, std::size_t Cols, std::uint16_t Birth = conway_life.birth,
+	std::uint16_t Survival = conway_life.survival>
+class packed_state_updater {
+public:
+	using grid_type = packed_grid<Rows, Cols>;
+
+	packed_state_updater(packed_grid<Rows, Cols>& grid);
+	packed_state_updater(packed_grid<Rows, Cols>& grid, life_rule rule);
+
+	// Updates each row whose first cell index is in [begin_idx, end_idx). Returns true if any of the cells changed
+	// state.
+	bool update(std::size_t begin_idx, std::size_t end_idx);
+	// Also adds the population of the updated rows, and the cells born and died, to census.
+	bool update(std::size_t begin_idx, std::size_t end_idx, cell_census& census);
+	// Advances the same rows by several generations in one pass over the grid, like state_updater.
+	void update(std::size_t begin_idx, std::size_t end_idx, std::size_t generations);
+	void update(std::size_t begin_idx, std::size_t end_idx, std::size_t generations, cell_census& census);
+
+private:
+	using word_type = typename packed_grid<Rows, Cols>::word_type;
+
+	static inline constexpr std::size_t _word_bits = packed_grid<Rows, Cols>::word_bits;
+	static inline constexpr std::size_t _vectorised_words = 256 / _word_bits;
+
+	packed_grid<Rows, Cols>* _grid;
+	rule_masks<Birth, Survival> _rule;
+
+	std::size_t _last_col_bit() const;
+	// Census is census_accumulator or null_census, like state_updater.
+	template<class Census>
+	bool _update(std::size_t begin_idx, std::size_t end_idx, Census& census);
+	template<class Census>
+	void _update(std::size_t begin_idx, std::size_t end_idx, std::size_t generations, Census& census);
+	// Updates one row of a buffer of num_rows rows into out. If wrap_rows is false, rows beyond the ends of the buffer
+	// are dead. Returns true if any of the cells changed state.
+	template<class Census>
+	bool _update_row(word_type const* curr, std::size_t num_rows, std::size_t row, bool wrap_rows, word_type* out,
+		Census& census) const;
+	// prev_row or next_row may be null, in which case it is treated as dead.
+	word_type _west(word_type const* row, word_type const* prev_row, std::size_t word_idx) const;
+	word_type _east(word_type const* row, word_type const* next_row, std::size_t word_idx) const;
+
+	// Bitwise operations shared by the scalar and vectorised bit-sliced logic.
+	static word_type _and(word_type a, word_type b);
+	static __m256i _and(__m256i a, __m256i b);
+	static word_type _or(word_type a, word_type b);
+	static __m256i _or(__m256i a, __m256i b);
+	static word_type _xor(word_type a, word_type b);
+	static __m256i _xor(__m256i a, __m256i b);
+	// ~a & b
+	static word_type _andnot(word_type a, word_type b);
+	static __m256i _andnot(__m256i a, __m256i b);
+	static word_type _not(word_type a);
+	static __m256i _not(__m256i a);
 
-	std::uint8_t _count_neighbours(std::size_t grid_idx) const;
-	void _single_update(std::size_t grid_idx);
-	void _vectorised_update(std::size_t grid_idx);
+	template<typename Word>
+	Word _next_state(Word above_west, Word above, Word above_east, Word west, Word centre, Word east,
+		Word below_west, Word below, Word below_east) const;
 };
 
 
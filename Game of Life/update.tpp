@@ -1,92 +1,591 @@
 #pragma once
 
 #include "grid.hpp"
+#include "instrument.hpp"
 #include "utility.hpp"
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <immintrin.h>
-#include <intrin.h>
+#include <utility>
+#include <vector>
 
 
-template<std::size_t Rows, std::size_t Cols>
-state_updater<Rows, Cols>::state_updater(game_grid<Rows, Cols>& grid) :
+template<std::size_t Rows, std::size_t Cols, std::uint16_t Birth, std::uint16_t Survival>
+state_updater<Rows, Cols, Birth, Survival>::state_updater(game_grid<Rows, Cols>& grid) :
+	_grid(&grid)
+{}
+
+template<std::size_t Rows, std::size_t Cols, std::uint16_t Birth, std::uint16_t Survival>
+state_updater<Rows, Cols, Birth, Survival>::state_updater(game_grid<Rows, Cols>& grid, life_rule rule) :
 	_grid(&grid),
-	_neighbour_lut(Rows * Cols),
-	_neighbours(Rows * Cols)
+	_rule(rule)
+{}
+
+template<std::size_t Rows, std::size_t Cols, std::uint16_t Birth, std::uint16_t Survival>
+bool state_updater<Rows, Cols, Birth, Survival>::update(std::size_t begin_idx, std::size_t end_idx)
 {
-	for (std::ptrdiff_t grid_idx = 0; grid_idx < Rows * Cols; ++grid_idx) {
-		for (std::size_t neighbour_idx = 0; neighbour_idx < _neighbour_offsets.size(); ++neighbour_idx) {
-			std::ptrdiff_t const offset = _neighbour_offsets[neighbour_idx];
-			_neighbour_lut[grid_idx][neighbour_idx] = wrap(grid_idx + offset, Rows * Cols);
-		}
+	null_census census;
+	return _update(begin_idx, end_idx, census);
+}
+
+template<std::size_t Rows, std::size_t Cols, std::uint16_t Birth, std::uint16_t Survival>
+bool state_updater<Rows, Cols, Birth, Survival>::update(std::size_t begin_idx, std::size_t end_idx,
+	cell_census& census)
+{
+	census_accumulator accumulator;
+	bool const changed = _update(begin_idx, end_idx, accumulator);
+	accumulator.add_to(census);
+	return changed;
+}
+
+template<std::size_t Rows, std::size_t Cols, std::uint16_t Birth, std::uint16_t Survival>
+void state_updater<Rows, Cols, Birth, Survival>::update(std::size_t begin_idx, std::size_t end_idx,
+	std::size_t generations)
+{
+	null_census census;
+	_update(begin_idx, end_idx, generations, census);
+}
+
+template<std::size_t Rows, std::size_t Cols, std::uint16_t Birth, std::uint16_t Survival>
+void state_updater<Rows, Cols, Birth, Survival>::update(std::size_t begin_idx, std::size_t end_idx,
+	std::size_t generations, cell_census& census)
+{
+	census_accumulator accumulator;
+	_update(begin_idx, end_idx, generations, accumulator);
+	accumulator.add_to(census);
+}
+
+template<std::size_t Rows, std::size_t Cols, std::uint16_t Birth, std::uint16_t Survival>
+template<class Census>
+bool state_updater<Rows, Cols, Birth, Survival>::_update(std::size_t begin_idx, std::size_t end_idx,
+	Census& census)
+{
+	debug_assert(end_idx >= begin_idx);
+
+	// Only the first and last _wrap_margin() cells need their neighbour indices wrapped. On very small grids these
+	// ranges overlap and there is no interior.
+	std::size_t const size = _grid->size();
+	std::size_t const wrap_margin = _wrap_margin();
+	std::size_t const interior_begin = std::min(std::max(begin_idx, wrap_margin), end_idx);
+	std::size_t const interior_end = std::max(std::min(end_idx, size - std::min(size, wrap_margin)), interior_begin);
+
+	bool changed = false;
+	for (std::size_t grid_idx = begin_idx; grid_idx < interior_begin; ++grid_idx) {
+		changed |= _single_update(grid_idx, census);
+	}
+	changed |= _interior_update(_grid->curr(), _grid->next() + interior_begin, interior_begin, interior_end,
+		_neighbour_offsets(), census);
+	for (std::size_t grid_idx = interior_end; grid_idx < end_idx; ++grid_idx) {
+		changed |= _single_update(grid_idx, census);
 	}
+	return changed;
 }
 
-template<std::size_t Rows, std::size_t Cols>
-void state_updater<Rows, Cols>::precomp(std::size_t begin_idx, std::size_t end_idx)
+template<std::size_t Rows, std::size_t Cols, std::uint16_t Birth, std::uint16_t Survival>
+template<class Census>
+void state_updater<Rows, Cols, Birth, Survival>::_update(std::size_t begin_idx, std::size_t end_idx,
+	std::size_t generations, Census& census)
 {
 	debug_assert(end_idx >= begin_idx);
 
-	for (std::size_t grid_idx = begin_idx; grid_idx < end_idx; ++grid_idx) {
-		_neighbours[grid_idx] = _count_neighbours(grid_idx);
+	if (generations <= 1) {
+		if (generations == 1) {
+			_update(begin_idx, end_idx, census);
+		}
+		return;
+	}
+
+	// Cells within _wrap_margin() of the ends of the block can't be updated, so the valid part of the block shrinks by
+	// that much from each end every generation.
+	std::size_t const size = _grid->size();
+	std::size_t const wrap_margin = _wrap_margin();
+	std::size_t const halo = generations * wrap_margin;
+	std::size_t const block_size = end_idx - begin_idx + 2 * halo;
+	auto const offsets = _neighbour_offsets();
+
+	thread_local std::vector<std::uint8_t> block;
+	thread_local std::vector<std::uint8_t> next_block;
+	block.resize(block_size);
+	next_block.resize(block_size);
+
+	copy_wrapped(_grid->curr(), size, (begin_idx + size - halo % size) % size, block_size, block.data());
+	null_census block_census;
+	for (std::size_t gen = 1; gen < generations; ++gen) {
+		std::size_t const valid_begin = gen * wrap_margin;
+		_interior_update(block.data(), next_block.data() + valid_begin, valid_begin, block_size - valid_begin, offsets,
+			block_census);
+		std::swap(block, next_block);
 	}
+	// The last generation only needs the original cells, which are written straight to the grid, and counted.
+	_interior_update(block.data(), _grid->next() + begin_idx, halo, halo + end_idx - begin_idx, offsets, census);
+}
+
+template<std::size_t Rows, std::size_t Cols, std::uint16_t Birth, std::uint16_t Survival>
+std::size_t state_updater<Rows, Cols, Birth, Survival>::_wrap_margin() const
+{
+	return _grid->cols() + 1;
+}
+
+template<std::size_t Rows, std::size_t Cols, std::uint16_t Birth, std::uint16_t Survival>
+typename state_updater<Rows, Cols, Birth, Survival>::neighbour_offsets
+state_updater<Rows, Cols, Birth, Survival>::_neighbour_offsets() const
+{
+	auto const cols = static_cast<std::ptrdiff_t>(_grid->cols());
+	return {
+		-cols - 1, -cols, -cols + 1,
+		-1,				  1,
+		cols - 1,  cols,  cols + 1
+	};
+}
+
+template<std::size_t Rows, std::size_t Cols, std::uint16_t Birth, std::uint16_t Survival>
+template<class Census>
+bool state_updater<Rows, Cols, Birth, Survival>::_single_update(std::size_t grid_idx, Census& census)
+{
+	std::uint8_t neighbours = 0;
+	for (auto const offset : _neighbour_offsets()) {
+		neighbours += _grid->get_curr(wrap(static_cast<std::ptrdiff_t>(grid_idx) + offset, _grid->size()));
+	}
+
+	bool const curr_state = _grid->get_curr(grid_idx);
+	bool const new_state = _next_state(curr_state, neighbours);
+	_grid->set_next(grid_idx, new_state);
+	census.add_cell(curr_state, new_state);
+	return new_state != curr_state;
 }
 
-template<std::size_t Rows, std::size_t Cols>
-void state_updater<Rows, Cols>::update(std::size_t begin_idx, std::size_t end_idx)
+template<std::size_t Rows, std::size_t Cols, std::uint16_t Birth, std::uint16_t Survival>
+template<class Census>
+bool state_updater<Rows, Cols, Birth, Survival>::_interior_update(std::uint8_t const* curr, std::uint8_t* out,
+	std::size_t begin_idx, std::size_t end_idx, neighbour_offsets const& offsets, Census& census) const
 {
 	debug_assert(end_idx >= begin_idx);
 
+	auto const make_lut = [](std::uint16_t mask) {
+		alignas(32) std::uint8_t lut[32] = {};
+		for (std::size_t neighbours = 0; neighbours <= 8; ++neighbours) {
+			lut[neighbours] = lut[neighbours + 16] = (mask >> neighbours) & 1u;
+		}
+		return _mm256_load_si256(reinterpret_cast<__m256i const*>(lut));
+	};
+	__m256i const birth_lut = make_lut(_rule.birth());
+	__m256i const survival_lut = make_lut(_rule.survival());
+
+	__m256i changes = _mm256_setzero_si256();
 	std::size_t grid_idx = begin_idx;
-	for (; grid_idx + _vectorised_count < end_idx; grid_idx += _vectorised_count) {
-		_vectorised_update(grid_idx);
+	for (; grid_idx + _vectorised_count <= end_idx; grid_idx += _vectorised_count) {
+		changes = _mm256_or_si256(changes, _vectorised_update(curr, out + (grid_idx - begin_idx), grid_idx, offsets,
+			birth_lut, survival_lut, census));
 	}
+	bool changed = !_mm256_testz_si256(changes, changes);
 	for (; grid_idx < end_idx; ++grid_idx) {
-		_single_update(grid_idx);
+		std::uint8_t neighbours = 0;
+		for (auto const offset : offsets) {
+			neighbours += curr[grid_idx + offset];
+		}
+		bool const new_state = _next_state(curr[grid_idx], neighbours);
+		out[grid_idx - begin_idx] = new_state;
+		census.add_cell(curr[grid_idx], new_state);
+		changed |= new_state != static_cast<bool>(curr[grid_idx]);
 	}
+	return changed;
 }
 
-template<std::size_t Rows, std::size_t Cols>
-std::uint8_t state_updater<Rows, Cols>::_count_neighbours(std::size_t grid_idx) const
+template<std::size_t Rows, std::size_t Cols, std::uint16_t Birth, std::uint16_t Survival>
+template<class Census>
+__m256i state_updater<Rows, Cols, Birth, Survival>::_vectorised_update(std::uint8_t const* curr, std::uint8_t* out,
+	std::size_t grid_idx, neighbour_offsets const& offsets, __m256i birth_lut, __m256i survival_lut, Census& census)
 {
-	std::uint8_t neighbours = 0;
-	for (auto const idx : _neighbour_lut[grid_idx]) {
-		neighbours += _grid->get_curr(idx);
+	// The neighbours are summed from the rows above and below and the cells either side, each loaded as a vector
+	// offset from grid_idx, so no neighbour counts are stored.
+	auto const load = [curr, grid_idx](std::ptrdiff_t offset) {
+		return _mm256_loadu_si256(reinterpret_cast<__m256i const*>(curr + grid_idx + offset));
+	};
+
+	__m256i neighbours_vec = load(offsets[0]);
+	for (std::size_t i = 1; i < offsets.size(); ++i) {
+		neighbours_vec = _mm256_add_epi8(neighbours_vec, load(offsets[i]));
 	}
-	return neighbours;
+	__m256i const states_vec = load(0);
+
+	__m256i new_states_vec;
+	if constexpr (Birth == conway_life.birth && Survival == conway_life.survival) {
+		// new_state = (neighbours == 2) ? state : (neighbours == 3)
+
+		__m256i const neighbours_eq2 = _mm256_cmpeq_epi8(neighbours_vec, _mm256_set1_epi8(2u));
+		__m256i const neighbours_eq3 = _mm256_cmpeq_epi8(neighbours_vec, _mm256_set1_epi8(3u));
+
+		new_states_vec = _mm256_blendv_epi8(neighbours_eq3, states_vec, neighbours_eq2);
+		new_states_vec = _mm256_and_si256(new_states_vec, _mm256_set1_epi8(1u));
+	}
+	else {
+		// new_state = state ? survival[neighbours] : birth[neighbours]
+		// The counts are at most 8, so they index the 16 byte lanes of the luts directly.
+
+		__m256i const born = _mm256_shuffle_epi8(birth_lut, neighbours_vec);
+		__m256i const survived = _mm256_shuffle_epi8(survival_lut, neighbours_vec);
+		new_states_vec = _mm256_or_si256(_mm256_and_si256(states_vec, survived), _mm256_andnot_si256(states_vec, born));
+	}
+
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(out), new_states_vec);
+	census.add_cells(states_vec, new_states_vec);
+	return _mm256_xor_si256(new_states_vec, states_vec);
 }
 
-template<std::size_t Rows, std::size_t Cols>
-void state_updater<Rows, Cols>::_single_update(std::size_t grid_idx)
+template<std::size_t Rows, std::size_t Cols, std::uint16_t Birth, std::uint16_t Survival>
+bool state_updater<Rows, Cols, Birth, Survival>::_next_state(bool state, std::uint8_t neighbours) const
 {
-	bool const curr_state = _grid->get_curr(grid_idx);
-	std::uint8_t const neighbours = _neighbours[grid_idx];
+	return ((state ? _rule.survival() : _rule.birth()) >> neighbours) & 1u;
+}
+
+
+template<std::size_t Rows, std::size_t Cols, std::uint16_t Birth, std::uint16_t Survival>
+packed_state_updater<Rows, Cols, Birth, Survival>::packed_state_updater(packed_grid<Rows, Cols>& grid) :
+	_grid(&grid)
+{}
+
+template<std::size_t Rows, std::size_t Cols, std::uint16_t Birth, std::uint16_t Survival>
+packed_state_updater<Rows, Cols, Birth, Survival>::packed_state_updater(packed_grid<Rows, Cols>& grid,
+	life_rule rule) :
+	_grid(&grid),
+	_rule(rule)
+{}
+
+template<std::size_t Rows, std::size_t Cols, std::uint16_t Birth, std::uint16_t Survival>
+bool packed_state_updater<Rows, Cols, Birth, Survival>::update(std::size_t begin_idx, std::size_t end_idx)
+{
+	null_census census;
+	return _update(begin_idx, end_idx, census);
+}
+
+template<std::size_t Rows, std::size_t Cols, std::uint16_t Birth, std::uint16_t Survival>
+bool packed_state_updater<Rows, Cols, Birth, Survival>::update(std::size_t begin_idx, std::size_t end_idx,
+	cell_census& census)
+{
+	census_accumulator accumulator;
+	bool const changed = _update(begin_idx, end_idx, accumulator);
+	accumulator.add_to(census);
+	return changed;
+}
+
+template<std::size_t Rows, std::size_t Cols, std::uint16_t Birth, std::uint16_t Survival>
+void packed_state_updater<Rows, Cols, Birth, Survival>::update(std::size_t begin_idx, std::size_t end_idx,
+	std::size_t generations)
+{
+	null_census census;
+	_update(begin_idx, end_idx, generations, census);
+}
+
+template<std::size_t Rows, std::size_t Cols, std::uint16_t Birth, std::uint16_t Survival>
+void packed_state_updater<Rows, Cols, Birth, Survival>::update(std::size_t begin_idx, std::size_t end_idx,
+	std::size_t generations, cell_census& census)
+{
+	census_accumulator accumulator;
+	_update(begin_idx, end_idx, generations, accumulator);
+	accumulator.add_to(census);
+}
+
+template<std::size_t Rows, std::size_t Cols, std::uint16_t Birth, std::uint16_t Survival>
+template<class Census>
+bool packed_state_updater<Rows, Cols, Birth, Survival>::_update(std::size_t begin_idx, std::size_t end_idx,
+	Census& census)
+{
+	debug_assert(end_idx >= begin_idx);
+
+	std::size_t const rows = _grid->rows();
+	std::size_t const cols = _grid->cols();
+	bool changed = false;
+	for (std::size_t row = (begin_idx + cols - 1) / cols; row * cols < end_idx; ++row) {
+		changed |= _update_row(_grid->curr(), rows, row, true, _grid->next() + row * _grid->row_words(), census);
+	}
+	return changed;
+}
 
-	bool new_state;
-	if (neighbours == 2) {
-		new_state = curr_state;
+template<std::size_t Rows, std::size_t Cols, std::uint16_t Birth, std::uint16_t Survival>
+template<class Census>
+void packed_state_updater<Rows, Cols, Birth, Survival>::_update(std::size_t begin_idx, std::size_t end_idx,
+	std::size_t generations, Census& census)
+{
+	debug_assert(end_idx >= begin_idx);
+
+	if (generations <= 1) {
+		if (generations == 1) {
+			_update(begin_idx, end_idx, census);
+		}
+		return;
+	}
+
+	std::size_t const rows = _grid->rows();
+	std::size_t const cols = _grid->cols();
+	std::size_t const row_words = _grid->row_words();
+	std::size_t const row_begin = (begin_idx + cols - 1) / cols;
+	std::size_t const row_end = (end_idx + cols - 1) / cols;
+	if (row_end <= row_begin) {
+		return;
+	}
+
+	// The cells beyond the ends of the block are missing, and the error this causes spreads by cols + 1 cells each
+	// generation. The halo rows must cover that.
+	std::size_t const halo_rows = generations + (generations + cols - 1) / cols;
+	std::size_t const block_rows = row_end - row_begin + 2 * halo_rows;
+
+	thread_local std::vector<word_type> block;
+	thread_local std::vector<word_type> next_block;
+	block.resize(block_rows * row_words);
+	next_block.resize(block_rows * row_words);
+
+	std::size_t const first_row = (row_begin + rows - halo_rows % rows) % rows;
+	copy_wrapped(_grid->curr(), rows * row_words, first_row * row_words, block.size(), block.data());
+	null_census block_census;
+	for (std::size_t gen = 1; gen < generations; ++gen) {
+		for (std::size_t row = gen; row < block_rows - gen; ++row) {
+			_update_row(block.data(), block_rows, row, false, next_block.data() + row * row_words, block_census);
+		}
+		std::swap(block, next_block);
+	}
+	// The last generation only needs the original rows, which are written straight to the grid, and counted.
+	for (std::size_t row = row_begin; row < row_end; ++row) {
+		_update_row(block.data(), block_rows, row - row_begin + halo_rows, false, _grid->next() + row * row_words,
+			census);
+	}
+}
+
+template<std::size_t Rows, std::size_t Cols, std::uint16_t Birth, std::uint16_t Survival>
+std::size_t packed_state_updater<Rows, Cols, Birth, Survival>::_last_col_bit() const
+{
+	return (_grid->cols() - 1) % _word_bits;
+}
+
+template<std::size_t Rows, std::size_t Cols, std::uint16_t Birth, std::uint16_t Survival>
+template<class Census>
+bool packed_state_updater<Rows, Cols, Birth, Survival>::_update_row(word_type const* curr, std::size_t num_rows,
+	std::size_t row, bool wrap_rows, word_type* out, Census& census) const
+{
+	std::size_t const row_words = _grid->row_words();
+	// Gets the row at an offset from row. Horizontal neighbours of the rows above and below come from 2 rows away.
+	auto const row_at = [=](std::ptrdiff_t offset) -> word_type const* {
+		auto const idx = static_cast<std::ptrdiff_t>(row) + offset;
+		if (idx >= 0 && idx < static_cast<std::ptrdiff_t>(num_rows)) {
+			return curr + idx * row_words;
+		}
+		else if (wrap_rows) {
+			return curr + wrap(idx, num_rows) * row_words;
+		}
+		else {
+			return nullptr;
+		}
+	};
+
+	word_type const* const above_2 = row_at(-2);
+	word_type const* const above = row_at(-1);
+	word_type const* const centre = row_at(0);
+	word_type const* const below = row_at(1);
+	word_type const* const below_2 = row_at(2);
+	debug_assert(above != nullptr && below != nullptr);
+
+	word_type changes = 0;
+	__m256i vectorised_changes = _mm256_setzero_si256();
+
+	auto const single_update = [&](std::size_t word_idx) {
+		word_type new_states = _next_state(
+			_west(above, above_2, word_idx), above[word_idx], _east(above, centre, word_idx),
+			_west(centre, above, word_idx), centre[word_idx], _east(centre, below, word_idx),
+			_west(below, centre, word_idx), below[word_idx], _east(below, below_2, word_idx));
+		if (word_idx == row_words - 1) {
+			new_states &= (word_type{2} << _last_col_bit()) - 1;
+		}
+		out[word_idx] = new_states;
+		census.add_word(centre[word_idx], new_states);
+		changes |= new_states ^ centre[word_idx];
+	};
+
+	// The first and last words of a row take their horizontal neighbours from the adjacent rows, so only the words
+	// between them can be shifted together with their neighbours loaded at a 1 word offset.
+	single_update(0);
+	std::size_t word_idx = 1;
+	for (; word_idx + _vectorised_words < row_words; word_idx += _vectorised_words) {
+		auto const load_shifted = [word_idx](word_type const* row, __m256i& west, __m256i& centre, __m256i& east) {
+			centre = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(row + word_idx));
+			__m256i const prev = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(row + word_idx - 1));
+			__m256i const succ = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(row + word_idx + 1));
+			west = _mm256_or_si256(_mm256_slli_epi64(centre, 1), _mm256_srli_epi64(prev, _word_bits - 1));
+			east = _mm256_or_si256(_mm256_srli_epi64(centre, 1), _mm256_slli_epi64(succ, _word_bits - 1));
+		};
+
+		__m256i above_west, above_vec, above_east, west, centre_vec, east, below_west, below_vec, below_east;
+		load_shifted(above, above_west, above_vec, above_east);
+		load_shifted(centre, west, centre_vec, east);
+		load_shifted(below, below_west, below_vec, below_east);
+		__m256i const new_states = _next_state(above_west, above_vec, above_east, west, centre_vec, east,
+			below_west, below_vec, below_east);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + word_idx), new_states);
+		census.add_words(centre_vec, new_states);
+		vectorised_changes = _mm256_or_si256(vectorised_changes, _mm256_xor_si256(new_states, centre_vec));
+	}
+	for (; word_idx < row_words; ++word_idx) {
+		single_update(word_idx);
+	}
+
+	return changes != 0 || !_mm256_testz_si256(vectorised_changes, vectorised_changes);
+}
+
+template<std::size_t Rows, std::size_t Cols, std::uint16_t Birth, std::uint16_t Survival>
+typename packed_state_updater<Rows, Cols, Birth, Survival>::word_type
+packed_state_updater<Rows, Cols, Birth, Survival>::_west(word_type const* row, word_type const* prev_row,
+	std::size_t word_idx) const
+{
+	// Bit i of the result is the cell before bit i. Like state_updater, the grid wraps as one flat array, so the cell
+	// before the start of a row is the end of the previous row.
+	word_type carry;
+	if (word_idx == 0) {
+		carry = prev_row == nullptr ? 0u : (prev_row[_grid->row_words() - 1] >> _last_col_bit()) & 1u;
 	}
 	else {
-		new_state = neighbours == 3;
+		carry = row[word_idx - 1] >> (_word_bits - 1);
 	}
+	return (row[word_idx] << 1) | carry;
+}
 
-	_grid->set_next(grid_idx, new_state);
+template<std::size_t Rows, std::size_t Cols, std::uint16_t Birth, std::uint16_t Survival>
+typename packed_state_updater<Rows, Cols, Birth, Survival>::word_type
+packed_state_updater<Rows, Cols, Birth, Survival>::_east(word_type const* row, word_type const* next_row,
+	std::size_t word_idx) const
+{
+	// Bit i of the result is the cell after bit i. The cell after the end of a row is the start of the next row.
+	std::size_t const row_words = _grid->row_words();
+	word_type carry;
+	if (word_idx == row_words - 1) {
+		carry = next_row == nullptr ? 0u : (next_row[0] & 1u) << _last_col_bit();
+	}
+	else {
+		carry = row[word_idx + 1] << (_word_bits - 1);
+	}
+	return (row[word_idx] >> 1) | carry;
+}
+
+template<std::size_t Rows, std::size_t Cols, std::uint16_t Birth, std::uint16_t Survival>
+typename packed_state_updater<Rows, Cols, Birth, Survival>::word_type
+packed_state_updater<Rows, Cols, Birth, Survival>::_and(word_type a, word_type b)
+{
+	return a & b;
 }
 
-template<std::size_t Rows, std::size_t Cols>
-void state_updater<Rows, Cols>::_vectorised_update(std::size_t grid_idx)
+template<std::size_t Rows, std::size_t Cols, std::uint16_t Birth, std::uint16_t Survival>
+__m256i packed_state_updater<Rows, Cols, Birth, Survival>::_and(__m256i a, __m256i b)
 {
-	// new_state = (neighbours == 2) ? state : (neighbours == 3)
+	return _mm256_and_si256(a, b);
+}
 
-	__m256i const neighbours_vec = _mm256_load_si256(reinterpret_cast<__m256i const*>(_neighbours.data() + grid_idx));
-	__m256i const states_vec = _mm256_load_si256(reinterpret_cast<__m256i const*>(_grid->curr() + grid_idx));
+template<std::size_t Rows, std::size_t Cols, std::uint16_t Birth, std::uint16_t Survival>
+typename packed_state_updater<Rows, Cols, Birth, Survival>::word_type
+packed_state_updater<Rows, Cols, Birth, Survival>::_or(word_type a, word_type b)
+{
+	return a | b;
+}
 
-	__m256i const neighbours_eq2 = _mm256_cmpeq_epi8(neighbours_vec, _mm256_set1_epi8(2u));
-	__m256i const neighbours_eq3 = _mm256_cmpeq_epi8(neighbours_vec, _mm256_set1_epi8(3u));
-	
-	__m256i new_states_vec = _mm256_blendv_epi8(neighbours_eq3, states_vec, neighbours_eq2);
-	new_states_vec = _mm256_and_si256(new_states_vec, _mm256_set1_epi8(1u));
+template<std::size_t Rows, std::size_t Cols, std::uint16_t Birth, std::uint16_t Survival>
+__m256i packed_state_updater<Rows, Cols, Birth, Survival>::_or(__m256i a, __m256i b)
+{
+	return _mm256_or_si256(a, b);
+}
+
+template<std::size_t Rows, std::size_t Cols, std::uint16_t Birth, std::uint16_t Survival>
+typename packed_state_updater<Rows, Cols, Birth, Survival>::word_type
+packed_state_updater<Rows, Cols, Birth, Survival>::_xor(word_type a, word_type b)
+{
+	return a ^ b;
+}
+
+template<std::size_t Rows, std::size_t Cols, std::uint16_t Birth, std::uint16_t Survival>
+__m256i packed_state_updater<Rows, Cols, Birth, Survival>::_xor(__m256i a, __m256i b)
+{
+	return _mm256_xor_si256(a, b);
+}
+
+template<std::size_t Rows, std::size_t Cols, std::uint16_t Birth, std::uint16_t Survival>
+typename packed_state_updater<Rows, Cols, Birth, Survival>::word_type
+packed_state_updater<Rows, Cols, Birth, Survival>::_andnot(word_type a, word_type b)
+{
+	return ~a & b;
+}
 
-	_mm256_store_si256(reinterpret_cast<__m256i*>(_grid->next() + grid_idx), new_states_vec);
+template<std::size_t Rows, std::size_t Cols, std::uint16_t Birth, std::uint16_t Survival>
+__m256i packed_state_updater<Rows, Cols, Birth, Survival>::_andnot(__m256i a, __m256i b)
+{
+	return _mm256_andnot_si256(a, b);
+}
+
+template<std::size_t Rows, std::size_t Cols, std::uint16_t Birth, std::uint16_t Survival>
+typename packed_state_updater<Rows, Cols, Birth, Survival>::word_type
+packed_state_updater<Rows, Cols, Birth, Survival>::_not(word_type a)
+{
+	return ~a;
+}
+
+template<std::size_t Rows, std::size_t Cols, std::uint16_t Birth, std::uint16_t Survival>
+__m256i packed_state_updater<Rows, Cols, Birth, Survival>::_not(__m256i a)
+{
+	return _mm256_xor_si256(a, _mm256_set1_epi8(-1));
+}
+
+template<std::size_t Rows, std::size_t Cols, std::uint16_t Birth, std::uint16_t Survival>
+template<typename Word>
+Word packed_state_updater<Rows, Cols, Birth, Survival>::_next_state(Word above_west, Word above, Word above_east,
+	Word west, Word centre, Word east, Word below_west, Word below, Word below_east) const
+{
+	// Each bit position holds an independent cell, so the neighbour count is built up as a bit-sliced binary number.
+	auto const full_add = [](Word a, Word b, Word c, Word& sum, Word& carry) {
+		Word const half_sum = _xor(a, b);
+		sum = _xor(half_sum, c);
+		carry = _or(_and(a, b), _and(half_sum, c));
+	};
+
+	Word ones_a, twos_a;
+	full_add(above_west, above, above_east, ones_a, twos_a);
+	Word ones_b, twos_b;
+	full_add(below_west, below, below_east, ones_b, twos_b);
+	Word const ones_c = _xor(west, east);
+	Word const twos_c = _and(west, east);
+
+	Word count_1, twos_d;
+	full_add(ones_a, ones_b, ones_c, count_1, twos_d);
+	Word twos_sum, fours_a;
+	full_add(twos_a, twos_b, twos_c, twos_sum, fours_a);
+	Word const count_2 = _xor(twos_sum, twos_d);
+	Word const fours_b = _and(twos_sum, twos_d);
+	// Set for counts of 4 to 7. A count of 8 sets neither count_2 nor count_4, so it is correctly treated as dead.
+	Word const count_4 = _xor(fours_a, fours_b);
+
+	if constexpr (Birth == conway_life.birth && Survival == conway_life.survival) {
+		// new_state = (neighbours == 3) || (state && neighbours == 2)
+		return _andnot(count_4, _and(count_2, _or(count_1, centre)));
+	}
+	else {
+		// Other rules look up the new state in the masks with a tree of selects on the bits of the count, starting from
+		// the mask bit for each count, picked by the state. For a fixed rule the mask bits are constant, so most of the
+		// selects fold away.
+		auto const select = [](Word cond, Word if_set, Word if_clear) {
+			return _or(_and(cond, if_set), _andnot(cond, if_clear));
+		};
+		auto const lookup = [&](std::size_t neighbours) {
+			Word const born = ((_rule.birth() >> neighbours) & 1u) ? _not(Word{}) : Word{};
+			Word const survived = ((_rule.survival() >> neighbours) & 1u) ? _not(Word{}) : Word{};
+			return select(centre, survived, born);
+		};
+
+		Word by_count_1[4];
+		for (std::size_t i = 0; i < 4; ++i) {
+			by_count_1[i] = select(count_1, lookup(2 * i + 1), lookup(2 * i));
+		}
+		Word const by_count_2[2] = {
+			select(count_2, by_count_1[1], by_count_1[0]),
+			select(count_2, by_count_1[3], by_count_1[2])
+		};
+		Word const by_count_4 = select(count_4, by_count_2[1], by_count_2[0]);
+		// A count of 8 clears the other bits, so it would otherwise look up a count of 0.
+		Word const count_8 = _and(fours_a, fours_b);
+		return select(count_8, lookup(8), by_count_4);
+	}
 }
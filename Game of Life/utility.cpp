@@ -1,20 +1,12 @@
 #include "utility.hpp"
 
+#include <algorithm>
 #include <cstddef>
-#include <cstdlib>
-#include <string>
-#define NOMINMAX
-#include <Windows.h>
+#include <thread>
+#include <utility>
+#include <vector>
 
 
-void set_console_size(HANDLE console_handle, std::size_t rows, std::size_t cols)
-{
-	auto const rows_str = std::to_string(rows + 1);
-	auto const cols_str = std::to_string(cols + 1);
-	auto const str = "mode con cols=" + cols_str + " lines=" + rows_str;
-	std::system(str.c_str());
-}
-
 std::size_t wrap(std::ptrdiff_t x, std::size_t bound)
 {
 	debug_assert(x >= -static_cast<std::ptrdiff_t>(bound));
@@ -22,7 +14,7 @@ std::size_t wrap(std::ptrdiff_t x, std::size_t bound)
 	if (x < 0) {
 		res = x + bound;
 	}
-	else if (x >= bound) {
+	else if (static_cast<std::size_t>(x) >= bound) {
 		res = x % bound;
 	}
 	else {
@@ -31,3 +23,32 @@ std::size_t wrap(std::ptrdiff_t x, std::size_t bound)
 	debug_assert(res < bound);
 	return res;
 }
+
+std::vector<std::pair<std::size_t, std::size_t>> partition(std::size_t val, std::size_t num_partitions)
+{
+	std::vector<std::pair<std::size_t, std::size_t>> res(num_partitions);
+	std::size_t const div = val / num_partitions;
+	std::size_t mod = val % num_partitions;
+
+	std::size_t offset = 0;
+	for (std::size_t i = 0; i < num_partitions; ++i) {
+		res[i].first = offset;
+		if (offset < val) {
+			std::size_t const extra = mod > 0;
+			std::size_t const count = div + extra;
+			res[i].second = count;
+			offset += count;
+			mod -= extra;
+		}
+		else {
+			res[i].second = 0;
+		}
+	}
+
+	return res;
+}
+
+std::size_t default_num_threads()
+{
+	return std::max(std::thread::hardware_concurrency(), 1u);
+}
@@ -5,8 +5,7 @@
 #include <cstddef>
 #include <memory>
 #include <utility>
-#define NOMINMAX
-#include <Windows.h>
+#include <vector>
 
 
 template<typename T, std::size_t Alignment>
@@ -38,19 +37,24 @@ private:
 template<typename T>
 T* align(T* buf, std::size_t actual_size, std::size_t required_size, std::size_t alignment);
 
-__forceinline void debug_assert(bool b)
+inline void debug_assert([[maybe_unused]] bool b)
 {
 #ifdef _DEBUG
 	assert(b);
 #endif
 }
 
-template<std::size_t NumPartitions>
-constexpr std::array<std::pair<std::size_t, std::size_t>, NumPartitions> partition(std::size_t val);
+// Splits [0, val) into num_partitions contiguous (offset, count) pairs whose counts differ by at most 1.
+std::vector<std::pair<std::size_t, std::size_t>> partition(std::size_t val, std::size_t num_partitions);
 
-void set_console_size(HANDLE console_handle, std::size_t rows, std::size_t cols);
+// std::thread::hardware_concurrency(), or 1 if that is unknown.
+std::size_t default_num_threads();
 
 std::size_t wrap(std::ptrdiff_t x, std::size_t bound);
 
+// Copies count elements from src, starting at start and wrapping back to the start of src after size elements.
+template<typename T>
+void copy_wrapped(T const* src, std::size_t size, std::size_t start, std::size_t count, T* dst);
+
 
 #include "utility.tpp"
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <cstddef>
 #include <memory>
@@ -60,27 +61,16 @@ T* align(T* buf, std::size_t actual_size, std::size_t required_size, std::size_t
 	}
 }
 
-template<std::size_t NumPartitions>
-constexpr std::array<std::pair<std::size_t, std::size_t>, NumPartitions> partition(std::size_t val)
+template<typename T>
+void copy_wrapped(T const* src, std::size_t size, std::size_t start, std::size_t count, T* dst)
 {
-	std::array<std::pair<std::size_t, std::size_t>, NumPartitions> res{};
-	std::size_t const div = val / NumPartitions;
-	std::size_t mod = val % NumPartitions;
+	debug_assert(start < size);
 
-	std::size_t offset = 0;
-	for (std::size_t i = 0; i < NumPartitions; ++i) {
-		res[i].first = offset;
-		if (offset < val) {
-			std::size_t const extra = mod > 0;
-			std::size_t const count = div + extra;
-			res[i].second = count;
-			offset += count;
-			mod -= extra;
-		}
-		else {
-			res[i].second = 0;
-		}
+	while (count > 0) {
+		std::size_t const chunk = std::min(count, size - start);
+		std::copy_n(src + start, chunk, dst);
+		dst += chunk;
+		count -= chunk;
+		start = 0;
 	}
-
-	return res;
 }
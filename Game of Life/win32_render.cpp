@@ -1,29 +1,39 @@
-#pragma once
-
-#include "grid.hpp"
+#include "render.hpp"
 #include "utility.hpp"
+#include "win32_render.hpp"
 
 #define NOMINMAX
+#include <atlbase.h>
 #include <cstddef>
-#include <cstring>
+#include <cstdint>
+#include <cstdlib>
 #include <d2d1.h>
-#include <exception>
+#include <functional>
 #include <limits>
+#include <stdexcept>
+#include <string>
 #include <thread>
 #include <Windows.h>
 
 
-template<std::size_t Rows, std::size_t Cols>
-window_renderer<Rows, Cols>::~window_renderer()
+void set_console_size(HANDLE console_handle, std::size_t rows, std::size_t cols)
+{
+	auto const rows_str = std::to_string(rows + 1);
+	auto const cols_str = std::to_string(cols + 1);
+	auto const str = "mode con cols=" + cols_str + " lines=" + rows_str;
+	std::system(str.c_str());
+}
+
+
+window_renderer::~window_renderer()
 {
 	PostMessage(_window, _wm_definite_close, 0, 0);
 	_window_thread.join();
 }
 
-template<std::size_t Rows, std::size_t Cols>
-window_renderer<Rows, Cols>::window_renderer(game_grid<Rows,Cols> const& grid, std::function<void(void)> close_callback) :
-	_grid(&grid),
-	_pixels(Rows * Cols, 0),
+window_renderer::window_renderer(std::size_t rows, std::size_t cols, std::function<void(void)> close_callback) :
+	_rows(rows),
+	_cols(cols),
 	_window_ready(false),
 	_close_callback(close_callback)
 {
@@ -34,13 +44,16 @@ window_renderer<Rows, Cols>::window_renderer(game_grid<Rows,Cols> const& grid, s
 		throw std::runtime_error("Failed to initialise COM.");
 	}
 
+	// The render target is made here but drawn to by present() on the render pipeline's thread, so the factory has to
+	// be multi-threaded for Direct2D to synchronise the two.
 	CComPtr<ID2D1Factory> direct2d_factory = nullptr;
-	if (FAILED(D2D1CreateFactory(D2D1_FACTORY_TYPE_SINGLE_THREADED, &direct2d_factory))) {
+	if (FAILED(D2D1CreateFactory(D2D1_FACTORY_TYPE_MULTI_THREADED, &direct2d_factory))) {
 		throw std::runtime_error("Failed to create Direct2D factory.");
 	}
 	auto target_properties = D2D1::RenderTargetProperties();
 	target_properties.pixelFormat = D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_IGNORE);
-	auto hwnd_target_properties = D2D1::HwndRenderTargetProperties(_window, D2D1::SizeU(Cols, Rows));
+	auto hwnd_target_properties = D2D1::HwndRenderTargetProperties(_window,
+		D2D1::SizeU(static_cast<UINT32>(_cols), static_cast<UINT32>(_rows)));
 
 	if (FAILED(direct2d_factory->CreateHwndRenderTarget(target_properties, hwnd_target_properties, &_render_target))) {
 		throw std::runtime_error("Failed to create Direct2D render target.");
@@ -58,25 +71,12 @@ window_renderer<Rows, Cols>::window_renderer(game_grid<Rows,Cols> const& grid, s
 	ShowWindow(_window, SW_SHOW);
 }
 
-template<std::size_t Rows, std::size_t Cols>
-void window_renderer<Rows, Cols>::render(std::size_t begin_idx, std::size_t end_idx)
+void window_renderer::present(std::uint32_t const* pixels, std::size_t rows, std::size_t cols, std::uint64_t)
 {
-	for (std::size_t grid_idx = begin_idx; grid_idx < end_idx; ++grid_idx)
-	{
-		if (_grid->get_curr(grid_idx)) {
-			std::memcpy(_pixels.data() + grid_idx, _live_pixel.data(), 4);
-		}
-		else {
-			std::memcpy(_pixels.data() + grid_idx, _dead_pixel.data(), 4);
-		}
-	}
-}
+	debug_assert(rows == _rows && cols == _cols);
 
-template<std::size_t Rows, std::size_t Cols>
-void window_renderer<Rows, Cols>::draw() const
-{
-	auto rect = D2D1::RectU(0, 0, Cols, Rows);
-	_bitmap->CopyFromMemory(&rect, _pixels.data(), Cols * 4);
+	auto rect = D2D1::RectU(0, 0, static_cast<UINT32>(cols), static_cast<UINT32>(rows));
+	_bitmap->CopyFromMemory(&rect, pixels, static_cast<UINT32>(cols * 4));
 
 	_render_target->BeginDraw();
 	_render_target->DrawBitmap(_bitmap);
@@ -85,8 +85,7 @@ void window_renderer<Rows, Cols>::draw() const
 	}
 }
 
-template<std::size_t Rows, std::size_t Cols>
-void window_renderer<Rows, Cols>::_window_func()
+void window_renderer::_window_func()
 {
 	LPCTSTR window_class_name = TEXT("Game of Life main");
 	LPCTSTR window_title = TEXT("Game of Life");
@@ -109,8 +108,8 @@ void window_renderer<Rows, Cols>::_window_func()
 
 	DWORD window_style = WS_CAPTION | WS_BORDER | WS_SYSMENU | WS_MINIMIZEBOX;
 	RECT window_rect{};
-	window_rect.bottom = Rows;
-	window_rect.right = Cols;
+	window_rect.bottom = static_cast<LONG>(_rows);
+	window_rect.right = static_cast<LONG>(_cols);
 	if (!AdjustWindowRect(&window_rect, window_style, FALSE)) {
 		throw std::runtime_error("Failed to adjust window size.");
 	}
@@ -139,8 +138,7 @@ void window_renderer<Rows, Cols>::_window_func()
 	}
 }
 
-template<std::size_t Rows, std::size_t Cols>
-LRESULT window_renderer<Rows, Cols>::_window_proc(HWND window, UINT msg, WPARAM wparam, LPARAM lparam)
+LRESULT window_renderer::_window_proc(HWND window, UINT msg, WPARAM wparam, LPARAM lparam)
 {
 	switch (msg) {
 	case WM_CLOSE: {
@@ -168,47 +166,24 @@ LRESULT window_renderer<Rows, Cols>::_window_proc(HWND window, UINT msg, WPARAM
 }
 
 
-template<std::size_t Rows, std::size_t Cols>
-console_renderer<Rows, Cols>::console_renderer(game_grid<Rows, Cols> const& grid, HANDLE console_handle) :
-	_grid(&grid),
-	_data(_buf_size),
+console_renderer::console_renderer(HANDLE console_handle) :
 	_console_handle(console_handle)
-{
-	for (std::size_t i = Cols; i < _buf_size; i += Cols + 1) {
-		_data[i] = '\n';
-	}
-}
+{}
 
-template<std::size_t Rows, std::size_t Cols>
-void console_renderer<Rows, Cols>::render(std::size_t begin_idx, std::size_t end_idx)
+void console_renderer::present(std::uint32_t const* pixels, std::size_t rows, std::size_t cols, std::uint64_t)
 {
-	debug_assert(end_idx >= begin_idx);
-
-	for (std::size_t grid_idx = begin_idx; grid_idx < end_idx; ++grid_idx) {
-		std::size_t buf_idx = grid_idx + (grid_idx / Cols);
-		_render(grid_idx, buf_idx);
+	_data.resize(rows * (cols + 1));
+	for (std::size_t row = 0; row < rows; ++row) {
+		char* const line = _data.data() + row * (cols + 1);
+		for (std::size_t col = 0; col < cols; ++col) {
+			line[col] = pixels[row * cols + col] == live_pixel ? live_cell : dead_cell;
+		}
+		line[cols] = '\n';
 	}
-}
 
-template<std::size_t Rows, std::size_t Cols>
-void console_renderer<Rows, Cols>::draw() const
-{
 	SetConsoleCursorPosition(_console_handle, COORD{0, 0});
-	DWORD written;
-	static_assert(_buf_size < std::numeric_limits<DWORD>::max());
-	debug_assert(WriteConsoleA(_console_handle, _data.data(), static_cast<DWORD>(_buf_size), &written, NULL));
-	debug_assert(written == _buf_size);
-}
-
-template<std::size_t Rows, std::size_t Cols>
-void console_renderer<Rows, Cols>::_render(std::size_t grid_idx, std::size_t buf_idx)
-{
-	bool const state = _grid->get_curr(grid_idx);
-	auto& c = _data[buf_idx];
-	if (state) {
-		c = live_cell;
-	}
-	else {
-		c = dead_cell;
-	}
+	DWORD written = 0;
+	debug_assert(_data.size() < std::numeric_limits<DWORD>::max());
+	BOOL const result = WriteConsoleA(_console_handle, _data.data(), static_cast<DWORD>(_data.size()), &written, NULL);
+	debug_assert(result && written == _data.size());
 }
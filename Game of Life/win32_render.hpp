@@ -0,0 +1,57 @@
+#pragma once
+
+// Presenters using Win32 and Direct2D. Included through render.hpp on Windows only.
+
+#define NOMINMAX
+#include <atlbase.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <d2d1.h>
+#include <functional>
+#include <thread>
+#include <vector>
+#include <Windows.h>
+
+
+// Presenter for a render_pipeline which shows frames in a window. The window runs its message loop on its own thread.
+class window_renderer {
+public:
+	~window_renderer();
+	window_renderer(std::size_t rows, std::size_t cols, std::function<void(void)> close_callback);
+
+	void present(std::uint32_t const* pixels, std::size_t rows, std::size_t cols, std::uint64_t generation);
+
+private:
+	// Signals for the window to actually be destroyed and the window thread to exit.
+	static inline constexpr UINT _wm_definite_close = WM_USER;
+
+	std::size_t _rows;
+	std::size_t _cols;
+	HWND _window;
+	CComPtr<ID2D1HwndRenderTarget> _render_target;
+	CComPtr<ID2D1Bitmap> _bitmap;
+	std::thread _window_thread;
+	std::atomic_bool _window_ready;
+	std::function<void(void)> _close_callback;
+
+	void _window_func();
+	static LRESULT CALLBACK _window_proc(HWND window, UINT msg, WPARAM wparam, LPARAM lparam);
+};
+
+// Presenter for a render_pipeline which draws frames as text in a console, with a character per pixel.
+class console_renderer {
+public:
+	console_renderer(HANDLE console_handle);
+
+	void present(std::uint32_t const* pixels, std::size_t rows, std::size_t cols, std::uint64_t generation);
+
+private:
+	static inline constexpr char live_cell = 'x';
+	static inline constexpr char dead_cell = ' ';
+
+	HANDLE _console_handle;
+	std::vector<char> _data;
+};
+
+void set_console_size(HANDLE console_handle, std::size_t rows, std::size_t cols);